@@ -13,11 +13,15 @@
 #ifndef CPP_UTILS_ALGORITHM_HPP
 #define CPP_UTILS_ALGORITHM_HPP
 
-#include <algorithm> // for vector_transform (std::transform)
-#include <random>    // for shuffle algorithms
-#include <vector>    // for vector_transform (std::vector)
+#include <algorithm>   // for std::transform
+#include <iterator>    // for std::iterator_traits
+#include <random>      // for shuffle algorithms
+#include <tuple>       // for foreach_zip
+#include <type_traits> // for vector_transform (std::remove_cvref_t)
+#include <vector>      // for vector_transform (std::vector)
 
 #include "assert.hpp"
+#include "aligned_vector.hpp"
 
 namespace cpp {
 
@@ -259,6 +263,34 @@ void foreach_dual_i(C1& c1, C2& c2, Functor&& fun) noexcept(noexcept(fun(*c1.beg
     cpp::foreach_dual_i(begin(c1), end(c1), begin(c2), std::forward<Functor>(fun));
 }
 
+/*!
+ * \brief Applies the given functor to the elements at the same position in all the given ranges, in order.
+ *
+ * The iteration stops at the end of the shortest range.
+ *
+ * \param fun The functor to apply, called with one element of each range.
+ * \param ranges The ranges to iterate
+ */
+template <typename Functor, typename... Ranges>
+void foreach_zip(Functor&& fun, Ranges&&... ranges) {
+    using std::begin;
+    using std::end;
+
+    auto its  = std::make_tuple(begin(ranges)...);
+    auto ends = std::make_tuple(end(ranges)...);
+
+    auto done = [&its, &ends]<std::size_t... I>(std::index_sequence<I...>) {
+        return (... || (std::get<I>(its) == std::get<I>(ends)));
+    };
+
+    while (!done(std::index_sequence_for<Ranges...>())) {
+        std::apply([&fun](auto&... it) {
+            fun(*it...);
+            (++it, ...);
+        }, its);
+    }
+}
+
 /*!
  * \brief Applies the given functor to each value in in range [first, last), in order
  * \param first The first value in the range
@@ -274,8 +306,45 @@ void foreach_n(std::size_t first, std::size_t last, Functor&& fun) {
 
 // Create a new vector with the transformation of a sequence
 
+namespace algorithm_detail {
+
+/*!
+ * \brief The type of the elements of a vector holding the transformation of [first, last) by fun
+ */
+template <typename Iterator, typename Functor>
+using transform_value_t = std::remove_cvref_t<std::invoke_result_t<Functor&, typename std::iterator_traits<Iterator>::reference>>;
+
+/*!
+ * \brief Append the transformation of a range at the end of the given vector.
+ *
+ * When the size of the range is known in constant time (random access
+ * iterators), the exact storage is reserved first. Each transformed value
+ * is then constructed directly into the uninitialized storage, without
+ * default construction and without reallocation.
+ *
+ * \param transformed The vector to fill
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The transform functor
+ */
+template <typename Vector, typename Iterator, typename Functor>
+void transform_into(Vector& transformed, Iterator first, Iterator last, Functor& fun) {
+    if constexpr (std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>) {
+        transformed.reserve(transformed.size() + std::distance(first, last));
+    }
+
+    for (; first != last; ++first) {
+        transformed.emplace_back(fun(*first));
+    }
+}
+
+} //end of namespace algorithm_detail
+
 /*!
  * \brief Transform a range and store the result into a vector
+ *
+ * For random access ranges, the vector is allocated only once.
+ *
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The transform functor
@@ -283,8 +352,26 @@ void foreach_n(std::size_t first, std::size_t last, Functor&& fun) {
  */
 template <typename Iterator, typename Functor>
 auto vector_transform(Iterator first, Iterator last, Functor&& fun) {
-    std::vector<decltype(fun(*first))> transformed;
-    std::transform(first, last, std::back_inserter(transformed), std::forward<Functor>(fun));
+    std::vector<algorithm_detail::transform_value_t<Iterator, Functor>> transformed;
+    algorithm_detail::transform_into(transformed, first, last, fun);
+    return transformed;
+}
+
+/*!
+ * \brief Transform a range and store the result into an aligned vector
+ *
+ * For random access ranges, the vector is allocated only once.
+ *
+ * \tparam A The alignment of the vector storage
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The transform functor
+ * \return An aligned vector filled with the transformed objects
+ */
+template <std::size_t A, typename Iterator, typename Functor>
+auto aligned_vector_transform(Iterator first, Iterator last, Functor&& fun) {
+    aligned_vector<algorithm_detail::transform_value_t<Iterator, Functor>, A> transformed;
+    algorithm_detail::transform_into(transformed, first, last, fun);
     return transformed;
 }
 
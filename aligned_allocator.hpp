@@ -13,8 +13,16 @@
 #ifndef CPP_ALIGNED_ALLOCATOR_HPP
 #define CPP_ALIGNED_ALLOCATOR_HPP
 
+#ifdef CPP_UTILS_NO_EXCEPT
+#include <iostream>
+#else
 #include <stdexcept>
+#endif
+
 #include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
 
 namespace cpp {
 
@@ -64,10 +72,14 @@ struct aligned_allocator {
         return !(*this == other);
     }
 
-    void construct(T* const p, const T& t) const {
+    /*!
+     * \brief Construct an object in previously allocated storage
+     */
+    template <typename... Args>
+    void construct(T* const p, Args&&... args) const {
         void* const pv = static_cast<void*>(p);
 
-        new (pv) T(t);
+        new (pv) T(std::forward<Args>(args)...);
     }
 
     /*!
@@ -131,14 +143,24 @@ struct aligned_allocator {
         // The Standardization Committee recommends that std::length_error
         // be thrown in the case of integer overflow.
         if (n > max_size()) {
+#ifndef CPP_UTILS_NO_EXCEPT
             throw std::length_error("aligned_allocator<T>::allocate() - Integer overflow.");
+#else
+            std::cerr << "cpp_utils: aligned_allocator<T>::allocate() - Integer overflow (exceptions disabled)" << std::endl;
+            std::abort();
+#endif
         }
 
         void* pv = aligned_allocate(n);
 
         // Allocators should throw std::bad_alloc in the case of memory allocation failure.
         if (!pv) {
+#ifndef CPP_UTILS_NO_EXCEPT
             throw std::bad_alloc();
+#else
+            std::cerr << "cpp_utils: aligned_allocator<T>::allocate() - Allocation failure (exceptions disabled)" << std::endl;
+            std::abort();
+#endif
         }
 
         return static_cast<T*>(pv);
@@ -0,0 +1,571 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file bitset.hpp
+ * \brief Contains dynamically-sized dense bitsets, with an atomic variant
+ * for concurrent marking.
+ */
+
+#ifndef CPP_UTILS_BITSET_HPP
+#define CPP_UTILS_BITSET_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "assert.hpp"
+#include "aligned_vector.hpp"
+#include "cache_line.hpp"
+
+namespace cpp {
+
+namespace bitset_detail {
+
+using word_t = uint64_t; ///< The type of storage words
+
+constexpr std::size_t word_bits = 64; ///< The number of bits per word
+
+/*!
+ * \brief Returns the number of words necessary to store n bits
+ */
+constexpr std::size_t words_for(std::size_t n) {
+    return (n + word_bits - 1) / word_bits;
+}
+
+/*!
+ * \brief Returns the mask of the valid bits of the last word of a bitset of n bits
+ */
+constexpr word_t tail_mask(std::size_t n) {
+    return n % word_bits ? (word_t(1) << (n % word_bits)) - 1 : ~word_t(0);
+}
+
+#ifdef __AVX2__
+
+/*!
+ * \brief Count the number of bits set in 4 words using an in-register lookup table
+ */
+inline __m256i popcount_256(__m256i v) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+
+    const __m256i lo = _mm256_and_si256(v, low_mask);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    const __m256i c  = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+
+    return _mm256_sad_epu8(c, _mm256_setzero_si256());
+}
+
+#endif
+
+/*!
+ * \brief Count the number of bits set in the given words
+ * \param words The words
+ * \param n The number of words
+ */
+inline std::size_t popcount(const word_t* words, std::size_t n) {
+    std::size_t count = 0;
+    std::size_t i     = 0;
+
+#ifdef __AVX2__
+    __m256i acc = _mm256_setzero_si256();
+
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_epi64(acc, popcount_256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i))));
+    }
+
+    count += _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+#endif
+
+    for (; i < n; ++i) {
+        count += std::popcount(words[i]);
+    }
+
+    return count;
+}
+
+} //end of namespace bitset_detail
+
+/*!
+ * \brief A dynamically-sized dense bitset.
+ *
+ * The words are stored in cache-line aligned memory and the bulk operations
+ * (count, and/or/xor) are written as simple loops over the words so that the
+ * compiler can vectorize them. The bits past size() are always kept to zero.
+ */
+struct dense_bitset {
+    using word_t = bitset_detail::word_t; ///< The type of storage words
+
+    static constexpr std::size_t npos = std::size_t(-1); ///< Returned by the find functions when no bit is found
+
+    /*!
+     * \brief Construct an empty bitset
+     */
+    dense_bitset() = default;
+
+    /*!
+     * \brief Construct a bitset of n bits, all set to the given value
+     * \param n The number of bits
+     * \param value The initial value of the bits
+     */
+    explicit dense_bitset(std::size_t n, bool value = false) : n(n), storage(bitset_detail::words_for(n), value ? ~word_t(0) : word_t(0)) {
+        clear_tail();
+    }
+
+    /*!
+     * \brief Returns the number of bits of the bitset
+     */
+    std::size_t size() const noexcept {
+        return n;
+    }
+
+    /*!
+     * \brief Returns the number of storage words
+     */
+    std::size_t num_words() const noexcept {
+        return storage.size();
+    }
+
+    /*!
+     * \brief Returns a pointer to the storage words
+     */
+    word_t* words() noexcept {
+        return storage.data();
+    }
+
+    /*!
+     * \copydoc words
+     */
+    const word_t* words() const noexcept {
+        return storage.data();
+    }
+
+    /*!
+     * \brief Test the value of the i-th bit
+     */
+    bool test(std::size_t i) const {
+        cpp_assert(i < n, "Out of bounds access in dense_bitset");
+        return storage[i / bitset_detail::word_bits] & (word_t(1) << (i % bitset_detail::word_bits));
+    }
+
+    /*!
+     * \copydoc test
+     */
+    bool operator[](std::size_t i) const {
+        return test(i);
+    }
+
+    /*!
+     * \brief Set the i-th bit to true
+     */
+    void set(std::size_t i) {
+        cpp_assert(i < n, "Out of bounds access in dense_bitset");
+        storage[i / bitset_detail::word_bits] |= word_t(1) << (i % bitset_detail::word_bits);
+    }
+
+    /*!
+     * \brief Set the i-th bit to the given value
+     */
+    void set(std::size_t i, bool value) {
+        value ? set(i) : reset(i);
+    }
+
+    /*!
+     * \brief Set the i-th bit to false
+     */
+    void reset(std::size_t i) {
+        cpp_assert(i < n, "Out of bounds access in dense_bitset");
+        storage[i / bitset_detail::word_bits] &= ~(word_t(1) << (i % bitset_detail::word_bits));
+    }
+
+    /*!
+     * \brief Flip the value of the i-th bit
+     */
+    void flip(std::size_t i) {
+        cpp_assert(i < n, "Out of bounds access in dense_bitset");
+        storage[i / bitset_detail::word_bits] ^= word_t(1) << (i % bitset_detail::word_bits);
+    }
+
+    /*!
+     * \brief Set all the bits to true
+     */
+    void set_all() {
+        std::fill(storage.begin(), storage.end(), ~word_t(0));
+        clear_tail();
+    }
+
+    /*!
+     * \brief Set all the bits to false
+     */
+    void reset_all() {
+        std::fill(storage.begin(), storage.end(), word_t(0));
+    }
+
+    /*!
+     * \brief Returns the number of bits set to true
+     */
+    std::size_t count() const {
+        return bitset_detail::popcount(storage.data(), storage.size());
+    }
+
+    /*!
+     * \brief Indicates if at least one bit is set
+     */
+    bool any() const {
+        for (auto w : storage) {
+            if (w) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Indicates if no bit is set
+     */
+    bool none() const {
+        return !any();
+    }
+
+    /*!
+     * \brief Returns the index of the first bit set, or npos if there is none
+     */
+    std::size_t find_first() const {
+        return find_from_word(0);
+    }
+
+    /*!
+     * \brief Returns the index of the first bit set after i, or npos if there is none
+     */
+    std::size_t find_next(std::size_t i) const {
+        if (++i >= n) {
+            return npos;
+        }
+
+        const auto w   = i / bitset_detail::word_bits;
+        const auto cur = storage[w] & (~word_t(0) << (i % bitset_detail::word_bits));
+
+        if (cur) {
+            return w * bitset_detail::word_bits + std::countr_zero(cur);
+        }
+
+        return find_from_word(w + 1);
+    }
+
+    /*!
+     * \brief Call the given functor with the index of each bit set, in order
+     */
+    template <typename Functor>
+    void for_each_set(Functor&& fun) const {
+        for (std::size_t w = 0; w < storage.size(); ++w) {
+            for (auto word = storage[w]; word; word &= word - 1) {
+                fun(w * bitset_detail::word_bits + std::countr_zero(word));
+            }
+        }
+    }
+
+    /*!
+     * \brief Returns the indices of all the bits set, in order
+     */
+    std::vector<std::size_t> set_indices() const {
+        std::vector<std::size_t> indices;
+        indices.reserve(count());
+        for_each_set([&indices](std::size_t i) { indices.push_back(i); });
+        return indices;
+    }
+
+    /*!
+     * \brief Compute the intersection with the given bitset of the same size
+     */
+    dense_bitset& operator&=(const dense_bitset& rhs) {
+        cpp_assert(n == rhs.n, "dense_bitset operations require bitsets of the same size");
+
+        auto* __restrict lhs_w       = storage.data();
+        const auto* __restrict rhs_w = rhs.storage.data();
+
+        for (std::size_t i = 0; i < storage.size(); ++i) {
+            lhs_w[i] &= rhs_w[i];
+        }
+
+        return *this;
+    }
+
+    /*!
+     * \brief Compute the union with the given bitset of the same size
+     */
+    dense_bitset& operator|=(const dense_bitset& rhs) {
+        cpp_assert(n == rhs.n, "dense_bitset operations require bitsets of the same size");
+
+        auto* __restrict lhs_w       = storage.data();
+        const auto* __restrict rhs_w = rhs.storage.data();
+
+        for (std::size_t i = 0; i < storage.size(); ++i) {
+            lhs_w[i] |= rhs_w[i];
+        }
+
+        return *this;
+    }
+
+    /*!
+     * \brief Compute the symmetric difference with the given bitset of the same size
+     */
+    dense_bitset& operator^=(const dense_bitset& rhs) {
+        cpp_assert(n == rhs.n, "dense_bitset operations require bitsets of the same size");
+
+        auto* __restrict lhs_w       = storage.data();
+        const auto* __restrict rhs_w = rhs.storage.data();
+
+        for (std::size_t i = 0; i < storage.size(); ++i) {
+            lhs_w[i] ^= rhs_w[i];
+        }
+
+        return *this;
+    }
+
+    /*!
+     * \brief Clear all the bits that are set in the given bitset of the same size
+     */
+    dense_bitset& and_not(const dense_bitset& rhs) {
+        cpp_assert(n == rhs.n, "dense_bitset operations require bitsets of the same size");
+
+        auto* __restrict lhs_w       = storage.data();
+        const auto* __restrict rhs_w = rhs.storage.data();
+
+        for (std::size_t i = 0; i < storage.size(); ++i) {
+            lhs_w[i] &= ~rhs_w[i];
+        }
+
+        return *this;
+    }
+
+    /*!
+     * \brief Flip all the bits
+     */
+    void flip_all() {
+        for (auto& w : storage) {
+            w = ~w;
+        }
+
+        clear_tail();
+    }
+
+    /*!
+     * \brief Count the bits set in the intersection with the given bitset, without computing it
+     */
+    std::size_t count_and(const dense_bitset& rhs) const {
+        cpp_assert(n == rhs.n, "dense_bitset operations require bitsets of the same size");
+
+        std::size_t c = 0;
+        for (std::size_t i = 0; i < storage.size(); ++i) {
+            c += std::popcount(storage[i] & rhs.storage[i]);
+        }
+
+        return c;
+    }
+
+    /*!
+     * \brief Compare two bitsets for equality
+     */
+    bool operator==(const dense_bitset& rhs) const {
+        return n == rhs.n && storage == rhs.storage;
+    }
+
+private:
+    std::size_t find_from_word(std::size_t w) const {
+        for (; w < storage.size(); ++w) {
+            if (storage[w]) {
+                return w * bitset_detail::word_bits + std::countr_zero(storage[w]);
+            }
+        }
+
+        return npos;
+    }
+
+    void clear_tail() {
+        if (!storage.empty()) {
+            storage.back() &= bitset_detail::tail_mask(n);
+        }
+    }
+
+    std::size_t n = 0;                                     ///< The number of bits
+    aligned_vector<word_t, cache_line_size> storage; ///< The storage words
+};
+
+/*!
+ * \brief Compute the intersection of two bitsets
+ */
+inline dense_bitset operator&(dense_bitset lhs, const dense_bitset& rhs) {
+    return lhs &= rhs;
+}
+
+/*!
+ * \brief Compute the union of two bitsets
+ */
+inline dense_bitset operator|(dense_bitset lhs, const dense_bitset& rhs) {
+    return lhs |= rhs;
+}
+
+/*!
+ * \brief Compute the symmetric difference of two bitsets
+ */
+inline dense_bitset operator^(dense_bitset lhs, const dense_bitset& rhs) {
+    return lhs ^= rhs;
+}
+
+/*!
+ * \brief A dynamically-sized bitset that can be modified concurrently.
+ *
+ * Each bit can be set or reset concurrently from several threads, without
+ * locks, with a single atomic operation on its word. This makes it possible
+ * to mark elements inside parallel loops with one bit per element.
+ *
+ * The bulk operations (count, find_first, to_dense) are not atomic as a
+ * whole and should be done once the marking threads are done.
+ */
+struct atomic_bitset {
+    using word_t = bitset_detail::word_t; ///< The type of storage words
+
+    static constexpr std::size_t npos = dense_bitset::npos; ///< Returned by the find functions when no bit is found
+
+    /*!
+     * \brief Construct a bitset of n bits, all set to false
+     * \param n The number of bits
+     */
+    explicit atomic_bitset(std::size_t n = 0) : n(n), nw(bitset_detail::words_for(n)), storage(new std::atomic<word_t>[nw]) {
+        for (std::size_t i = 0; i < nw; ++i) {
+            storage[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+     * \brief Returns the number of bits of the bitset
+     */
+    std::size_t size() const noexcept {
+        return n;
+    }
+
+    /*!
+     * \brief Test the value of the i-th bit
+     */
+    bool test(std::size_t i, std::memory_order order = std::memory_order_relaxed) const {
+        cpp_assert(i < n, "Out of bounds access in atomic_bitset");
+        return storage[i / bitset_detail::word_bits].load(order) & (word_t(1) << (i % bitset_detail::word_bits));
+    }
+
+    /*!
+     * \copydoc test
+     */
+    bool operator[](std::size_t i) const {
+        return test(i);
+    }
+
+    /*!
+     * \brief Set the i-th bit to true
+     * \return true if the bit was not set before (the caller is the one that set it)
+     */
+    bool set(std::size_t i, std::memory_order order = std::memory_order_relaxed) {
+        cpp_assert(i < n, "Out of bounds access in atomic_bitset");
+
+        const auto bit = word_t(1) << (i % bitset_detail::word_bits);
+        auto& word     = storage[i / bitset_detail::word_bits];
+
+        // Avoid the read-for-ownership when the bit is already set
+        if (word.load(std::memory_order_relaxed) & bit) {
+            return false;
+        }
+
+        return !(word.fetch_or(bit, order) & bit);
+    }
+
+    /*!
+     * \brief Set the i-th bit to false
+     * \return true if the bit was set before (the caller is the one that reset it)
+     */
+    bool reset(std::size_t i, std::memory_order order = std::memory_order_relaxed) {
+        cpp_assert(i < n, "Out of bounds access in atomic_bitset");
+
+        const auto bit = word_t(1) << (i % bitset_detail::word_bits);
+        return storage[i / bitset_detail::word_bits].fetch_and(~bit, order) & bit;
+    }
+
+    /*!
+     * \brief Set all the bits to false. Not thread-safe.
+     */
+    void reset_all() {
+        for (std::size_t i = 0; i < nw; ++i) {
+            storage[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /*!
+     * \brief Returns the number of bits set to true
+     */
+    std::size_t count() const {
+        std::size_t c = 0;
+        for (std::size_t i = 0; i < nw; ++i) {
+            c += std::popcount(storage[i].load(std::memory_order_relaxed));
+        }
+        return c;
+    }
+
+    /*!
+     * \brief Returns the index of the first bit set, or npos if there is none
+     */
+    std::size_t find_first() const {
+        for (std::size_t w = 0; w < nw; ++w) {
+            if (auto word = storage[w].load(std::memory_order_relaxed)) {
+                return w * bitset_detail::word_bits + std::countr_zero(word);
+            }
+        }
+
+        return npos;
+    }
+
+    /*!
+     * \brief Call the given functor with the index of each bit set, in order
+     */
+    template <typename Functor>
+    void for_each_set(Functor&& fun) const {
+        for (std::size_t w = 0; w < nw; ++w) {
+            for (auto word = storage[w].load(std::memory_order_relaxed); word; word &= word - 1) {
+                fun(w * bitset_detail::word_bits + std::countr_zero(word));
+            }
+        }
+    }
+
+    /*!
+     * \brief Returns a non-atomic copy of the bitset
+     */
+    dense_bitset to_dense() const {
+        dense_bitset dense(n);
+
+        for (std::size_t w = 0; w < nw; ++w) {
+            dense.words()[w] = storage[w].load(std::memory_order_relaxed);
+        }
+
+        return dense;
+    }
+
+private:
+    std::size_t n;                                 ///< The number of bits
+    std::size_t nw;                                ///< The number of words
+    std::unique_ptr<std::atomic<word_t>[]> storage; ///< The storage words
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_BITSET_HPP
@@ -0,0 +1,81 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file cache_line.hpp
+ * \brief Contains utilities to avoid false sharing between threads.
+ */
+
+#ifndef CPP_UTILS_CACHE_LINE_HPP
+#define CPP_UTILS_CACHE_LINE_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace cpp {
+
+/*!
+ * \brief The assumed size of a cache line, in bytes.
+ *
+ * std::hardware_destructive_interference_size is not used since it is
+ * not stable across compiler flags (and GCC warns about its use in
+ * headers).
+ */
+constexpr std::size_t cache_line_size = 64;
+
+/*!
+ * \brief A value padded and aligned to occupy its own cache line(s).
+ *
+ * Values of this type stored contiguously never share a cache line,
+ * which prevents false sharing when different threads modify them.
+ *
+ * \tparam T The type of the padded value
+ */
+template <typename T>
+struct alignas(cache_line_size) cache_padded {
+    T value; ///< The padded value
+
+    /*!
+     * \brief Construct the padded value from the given arguments
+     */
+    template <typename... Args>
+    explicit cache_padded(Args&&... args) : value(std::forward<Args>(args)...) {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Returns a reference to the padded value
+     */
+    T& operator*() {
+        return value;
+    }
+
+    /*!
+     * \brief Returns a reference to the padded value
+     */
+    const T& operator*() const {
+        return value;
+    }
+
+    /*!
+     * \brief Returns a pointer to the padded value
+     */
+    T* operator->() {
+        return &value;
+    }
+
+    /*!
+     * \brief Returns a pointer to the padded value
+     */
+    const T* operator->() const {
+        return &value;
+    }
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_CACHE_LINE_HPP
@@ -0,0 +1,459 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file execution.hpp
+ * \brief Contains an execution policy bound to a thread pool and the
+ * standard algorithms taking such a policy.
+ *
+ * Contrary to the standard execution policies, whose backend cannot be
+ * sized, the algorithms taking a cpp::pool_policy run all their tasks on
+ * the given thread pool:
+ *
+ * \code
+ * cpp::default_thread_pool<> pool(8);
+ * cpp::sort(cpp::pool_policy(pool), v.begin(), v.end());
+ * auto sum = cpp::reduce(cpp::pool_policy(pool), v.begin(), v.end(), 0.0);
+ * \endcode
+ *
+ * The ranges must be random access to be processed concurrently, the
+ * algorithms fall back to their serial counterparts otherwise.
+ */
+
+#ifndef CPP_UTILS_EXECUTION_HPP
+#define CPP_UTILS_EXECUTION_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace cpp {
+
+/*!
+ * \brief An execution policy running the algorithms on the given thread pool
+ * \tparam TP The type of thread pool
+ */
+template <typename TP>
+struct pool_execution_policy {
+    /*!
+     * \brief Construct a policy running on the given thread pool
+     */
+    explicit pool_execution_policy(TP& thread_pool) : pool(&thread_pool) {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Returns the thread pool of the policy
+     */
+    TP& thread_pool() const {
+        return *pool;
+    }
+
+private:
+    TP* pool; ///< The thread pool running the tasks
+};
+
+/*!
+ * \brief Returns an execution policy running the algorithms on the given thread pool
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ */
+template <typename TP>
+pool_execution_policy<TP> pool_policy(TP& thread_pool) {
+    return pool_execution_policy<TP>(thread_pool);
+}
+
+/*!
+ * \brief Traits to test if a type is a thread pool execution policy
+ */
+template <typename T>
+struct is_pool_execution_policy : std::false_type {};
+
+/*!
+ * \copydoc is_pool_execution_policy
+ */
+template <typename TP>
+struct is_pool_execution_policy<pool_execution_policy<TP>> : std::true_type {};
+
+/*!
+ * \brief Indicates if a type is a thread pool execution policy
+ */
+template <typename T>
+constexpr bool is_pool_execution_policy_v = is_pool_execution_policy<std::decay_t<T>>::value;
+
+namespace execution_detail {
+
+/*!
+ * \brief Returns the number of blocks to split n elements into
+ */
+template <typename TP>
+std::size_t blocks(const pool_execution_policy<TP>& policy, std::size_t n) {
+    return std::min(n, policy.thread_pool().size());
+}
+
+/*!
+ * \brief Reduce each block of [first, last) with the given functors and
+ * returns the optional partial result of each block, in order.
+ *
+ * The reduction of a block starts with the transformation of its first
+ * element, which avoids the need for an identity element.
+ */
+template <typename T, typename TP, typename Iterator, typename Reduce, typename Transform>
+std::vector<std::optional<T>> partial_reduce(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Reduce& reduce, Transform& transform) {
+    const std::size_t n = std::distance(first, last);
+    const auto b        = blocks(policy, n);
+
+    std::vector<std::optional<T>> partials(b);
+
+    if (n) {
+        // Not guarded only when both functors are nothrow_functor
+        using user_functor = std::conditional_t<parallel_detail::is_nothrow_functor<Reduce>, Transform, Reduce>;
+
+        parallel_detail::for_each_block<user_functor>(policy.thread_pool(), n, b, [first, &reduce, &transform, &partials](std::size_t block, std::size_t i_first, std::size_t i_last) {
+            auto it = first + i_first;
+            T acc   = transform(*it);
+
+            for (std::size_t i = i_first + 1; i < i_last; ++i) {
+                acc = reduce(std::move(acc), transform(*++it));
+            }
+
+            partials[block] = std::move(acc);
+        });
+    }
+
+    return partials;
+}
+
+} //end of namespace execution_detail
+
+/*!
+ * \brief Apply the given functor, concurrently, to each element of the range
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Iterator, typename Functor>
+void for_each(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        if (n) {
+            parallel_detail::for_each_block<Functor>(policy.thread_pool(), n, execution_detail::blocks(policy, n), [first, &fun](std::size_t /*b*/, std::size_t i_first, std::size_t i_last) {
+                std::for_each(first + i_first, first + i_last, fun);
+            });
+        }
+    } else {
+        cpp_unused(policy);
+        std::for_each(first, last, fun);
+    }
+}
+
+/*!
+ * \brief Apply the given functor, concurrently, to the n first elements of the range
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param n The number of elements
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last processed element
+ */
+template <typename TP, typename Iterator, typename Size, typename Functor>
+Iterator for_each_n(const pool_execution_policy<TP>& policy, Iterator first, Size n, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        for_each(policy, first, first + n, fun);
+        return first + n;
+    } else {
+        cpp_unused(policy);
+        return std::for_each_n(first, n, fun);
+    }
+}
+
+/*!
+ * \brief Transform, concurrently, each element of the range and store the results in out.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out The beginning of the output range
+ * \param fun The transform functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last written element
+ */
+template <typename TP, typename Iterator, typename OutputIterator, typename Functor>
+OutputIterator transform(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, OutputIterator out, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && parallel_detail::is_random_access<OutputIterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        if (n) {
+            parallel_detail::for_each_block<Functor>(policy.thread_pool(), n, execution_detail::blocks(policy, n), [first, out, &fun](std::size_t /*b*/, std::size_t i_first, std::size_t i_last) {
+                std::transform(first + i_first, first + i_last, out + i_first, fun);
+            });
+        }
+
+        return out + n;
+    } else {
+        cpp_unused(policy);
+        return std::transform(first, last, out, fun);
+    }
+}
+
+/*!
+ * \brief Transform, concurrently, each pair of elements of the two ranges and store the results in out.
+ * \param policy The execution policy
+ * \param first1 The beginning of the first range
+ * \param last1 The end of the first range
+ * \param first2 The beginning of the second range
+ * \param out The beginning of the output range
+ * \param fun The binary transform functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last written element
+ */
+template <typename TP, typename Iterator1, typename Iterator2, typename OutputIterator, typename Functor>
+OutputIterator transform(const pool_execution_policy<TP>& policy, Iterator1 first1, Iterator1 last1, Iterator2 first2, OutputIterator out, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator1> && parallel_detail::is_random_access<Iterator2> && parallel_detail::is_random_access<OutputIterator>) {
+        const std::size_t n = std::distance(first1, last1);
+
+        if (n) {
+            parallel_detail::for_each_block<Functor>(policy.thread_pool(), n, execution_detail::blocks(policy, n), [first1, first2, out, &fun](std::size_t /*b*/, std::size_t i_first, std::size_t i_last) {
+                std::transform(first1 + i_first, first1 + i_last, first2 + i_first, out + i_first, fun);
+            });
+        }
+
+        return out + n;
+    } else {
+        cpp_unused(policy);
+        return std::transform(first1, last1, first2, out, fun);
+    }
+}
+
+/*!
+ * \brief Transform, concurrently, each element of the range and reduce the results.
+ *
+ * The reduction functor must be associative and commutative, each block
+ * is reduced independently and the partial results are then reduced in
+ * order.
+ *
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The initial value of the reduction
+ * \param reduce The binary reduction functor
+ * \param transform The unary transform functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The reduced value
+ */
+template <typename TP, typename Iterator, typename T, typename Reduce, typename Transform>
+T transform_reduce(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, T init, Reduce reduce, Transform transform, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        for (auto& partial : execution_detail::partial_reduce<T>(policy, first, last, reduce, transform)) {
+            init = reduce(std::move(init), std::move(*partial));
+        }
+
+        return init;
+    } else {
+        cpp_unused(policy);
+        return std::transform_reduce(first, last, init, reduce, transform);
+    }
+}
+
+/*!
+ * \brief Reduce, concurrently, the elements of the range.
+ *
+ * The reduction functor must be associative and commutative.
+ *
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The initial value of the reduction
+ * \param reduce The binary reduction functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The reduced value
+ */
+template <typename TP, typename Iterator, typename T, typename Reduce>
+T reduce(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, T init, Reduce reduce, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return transform_reduce(policy, first, last, std::move(init), reduce, [](const auto& value) -> const auto& { return value; });
+}
+
+/*!
+ * \brief Sum, concurrently, the elements of the range, starting from init.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The initial value of the sum
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The sum of init and of the elements
+ */
+template <typename TP, typename Iterator, typename T>
+T reduce(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, T init, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return reduce(policy, first, last, std::move(init), std::plus<>());
+}
+
+/*!
+ * \brief Sum, concurrently, the elements of the range.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The sum of the elements
+ */
+template <typename TP, typename Iterator>
+auto reduce(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return reduce(policy, first, last, typename std::iterator_traits<Iterator>::value_type{});
+}
+
+/*!
+ * \brief Sort, concurrently, the elements of the range.
+ *
+ * Each block is sorted concurrently and the sorted blocks are then merged
+ * pairwise, the merges of each round being done concurrently as well. The
+ * first exception thrown by the comparison is rethrown once the tasks of
+ * its round are done. The sort is not stable.
+ *
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param comp The comparison functor
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Iterator, typename Compare>
+void sort(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Compare comp, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    static_assert(parallel_detail::is_random_access<Iterator>, "sort requires random access iterators");
+
+    const std::size_t n = std::distance(first, last);
+    const auto b        = execution_detail::blocks(policy, n);
+
+    if (b < 2) {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    auto& thread_pool = policy.thread_pool();
+
+    parallel_detail::for_each_block(thread_pool, n, b, [first, &comp](std::size_t /*b*/, std::size_t i_first, std::size_t i_last) {
+        std::sort(first + i_first, first + i_last, comp);
+    });
+
+    // Merge the runs [i * width, (i + 2) * width) blocks at a time, one merge per task
+    for (std::size_t width = 1; width < b; width *= 2) {
+        const std::size_t merges = (b - width + 2 * width - 1) / (2 * width);
+
+        parallel_detail::for_each_block(thread_pool, merges, merges, [first, &comp, n, b, width](std::size_t m, std::size_t /*first*/, std::size_t /*last*/) {
+            const std::size_t i        = m * 2 * width;
+            const std::size_t r_first  = n * i / b;
+            const std::size_t r_middle = n * (i + width) / b;
+            const std::size_t r_last   = n * std::min(b, i + 2 * width) / b;
+
+            std::inplace_merge(first + r_first, first + r_middle, first + r_last, comp);
+        });
+    }
+}
+
+/*!
+ * \brief Sort, concurrently, the elements of the range in ascending order.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Iterator>
+void sort(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    sort(policy, first, last, std::less<>());
+}
+
+/*!
+ * \brief Find, concurrently, the first element of the range satisfying the predicate.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator to the first matching element, last if there is none
+ */
+template <typename TP, typename Iterator, typename Predicate>
+Iterator find_if(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_find_if(policy.thread_pool(), first, last, pred);
+}
+
+/*!
+ * \brief Test, concurrently, if any element of the range satisfies the predicate.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns true for at least one element, false otherwise
+ */
+template <typename TP, typename Iterator, typename Predicate>
+bool any_of(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_any_of(policy.thread_pool(), first, last, pred);
+}
+
+/*!
+ * \brief Test, concurrently, if all the elements of the range satisfy the predicate.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns true for all the elements, false otherwise
+ */
+template <typename TP, typename Iterator, typename Predicate>
+bool all_of(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return !any_of(policy, first, last, [&pred](const auto& value) { return !pred(value); });
+}
+
+/*!
+ * \brief Test, concurrently, if no element of the range satisfies the predicate.
+ * \param policy The execution policy
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns false for all the elements, false otherwise
+ */
+template <typename TP, typename Iterator, typename Predicate>
+bool none_of(const pool_execution_policy<TP>& policy, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return !any_of(policy, first, last, pred);
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_EXECUTION_HPP
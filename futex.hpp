@@ -0,0 +1,144 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file futex.hpp
+ * \brief Contains low-level primitives to passively wait on atomic words.
+ *
+ * On Linux, the futex system call is used directly. On the other systems,
+ * the C++20 std::atomic wait/notify functions are used instead.
+ */
+
+#ifndef CPP_UTILS_FUTEX_HPP
+#define CPP_UTILS_FUTEX_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace cpp {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words must be lock-free 32-bit integers");
+
+/*!
+ * \brief Block the current thread as long as word contains the expected value.
+ *
+ * The function may return spuriously, callers must check their condition
+ * again.
+ *
+ * \param word The word to wait on
+ * \param expected The value the word must still hold to wait
+ */
+inline void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    word.wait(expected, std::memory_order_acquire);
+#endif
+}
+
+/*!
+ * \brief Wake one thread waiting on the given word
+ * \param word The word threads are waiting on
+ */
+inline void futex_wake_one(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+#else
+    word.notify_one();
+#endif
+}
+
+/*!
+ * \brief Wake all the threads waiting on the given word
+ * \param word The word threads are waiting on
+ */
+inline void futex_wake_all(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+    word.notify_all();
+#endif
+}
+
+/*!
+ * \brief An event count, to passively wait for a condition expressed on
+ * other atomic variables.
+ *
+ * A waiter calls prepare_wait(), checks its condition again and then calls
+ * wait() with the returned key if the condition is still not satisfied.
+ * A notifier first makes the condition true and then calls notify(). The
+ * notifier only pays for a system call when there is at least one waiter.
+ */
+struct event_count {
+    /*!
+     * \brief Announce that the current thread is about to wait.
+     * \return The key to pass to wait() or cancel_wait()
+     */
+    uint32_t prepare_wait() {
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    /*!
+     * \brief Wait until a notification happens after prepare_wait()
+     * \param key The key returned by prepare_wait()
+     */
+    void wait(uint32_t key) {
+        while (epoch.load(std::memory_order_acquire) == key) {
+            futex_wait(epoch, key);
+        }
+
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Cancel a wait after prepare_wait(), because the condition has
+     * been satisfied in the meantime.
+     */
+    void cancel_wait() {
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Wake one waiting thread, if any
+     */
+    void notify_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waiters.load(std::memory_order_relaxed)) {
+            epoch.fetch_add(1, std::memory_order_release);
+            futex_wake_one(epoch);
+        }
+    }
+
+    /*!
+     * \brief Wake all the waiting threads, if any
+     */
+    void notify_all() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waiters.load(std::memory_order_relaxed)) {
+            epoch.fetch_add(1, std::memory_order_release);
+            futex_wake_all(epoch);
+        }
+    }
+
+private:
+    std::atomic<uint32_t> epoch{0};   ///< Incremented on each notification with waiters
+    std::atomic<uint32_t> waiters{0}; ///< The number of threads currently waiting
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_FUTEX_HPP
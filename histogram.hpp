@@ -0,0 +1,291 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file histogram.hpp
+ * \brief Contains parallel histogram and counting algorithms.
+ *
+ * Instead of incrementing shared counters with atomic operations, each
+ * block of elements counts into its own private bins. The private bins
+ * are merged concurrently once all the blocks are done.
+ */
+
+#ifndef CPP_UTILS_HISTOGRAM_HPP
+#define CPP_UTILS_HISTOGRAM_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "assert.hpp"
+#include "cache_line.hpp"
+#include "hash.hpp"
+#include "parallel.hpp"
+
+namespace cpp {
+
+namespace histogram_detail {
+
+/*!
+ * \brief Returns the number of bins rounded up to full cache lines
+ */
+inline std::size_t padded_bins(std::size_t bins) {
+    constexpr std::size_t per_line = cache_line_size / sizeof(std::size_t);
+    return (bins + per_line - 1) / per_line * per_line;
+}
+
+/*!
+ * \brief The types of the counting map for the given type of key.
+ *
+ * String-like keys are stored as std::string and use the transparent
+ * string_hash, which lets the counts be looked up without building a
+ * string for each element.
+ */
+template <typename Key, typename Enable = void>
+struct count_map {
+    using key_type = Key;                                                 ///< The type of keys stored in the map
+    using type     = std::unordered_map<Key, std::size_t, std::hash<Key>>; ///< The type of map
+};
+
+/*!
+ * \copydoc count_map
+ */
+template <typename Key>
+struct count_map<Key, std::enable_if_t<std::is_convertible_v<const Key&, std::string_view>>> {
+    using key_type = std::string;                    ///< The type of keys stored in the map
+    using type     = string_hash_map<std::size_t>; ///< The type of map
+};
+
+/*!
+ * \brief Returns the partition of the given hash, among the given number of partitions.
+ *
+ * The hash is mixed (Fibonacci hashing) so that the partitions are not
+ * correlated with the buckets of the maps.
+ */
+inline std::size_t partition(std::size_t hash, std::size_t partitions) {
+    return static_cast<std::size_t>((static_cast<uint64_t>(hash) * UINT64_C(11400714819323198485)) >> 32) % partitions;
+}
+
+} //end of namespace histogram_detail
+
+/*!
+ * \brief The map type returned by parallel_count_by for the given type of key
+ */
+template <typename Key>
+using count_map_t = typename histogram_detail::count_map<std::decay_t<Key>>::type;
+
+/*!
+ * \brief Compute, concurrently, the histogram of the range [first, last).
+ *
+ * Each block of elements counts into its own private bins, aligned and
+ * padded to full cache lines. The private bins are then summed
+ * concurrently, each task merging a contiguous range of bins.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param bins The number of bins
+ * \param key_fn The functor returning the bin, in [0, bins), of an element
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The count of each bin
+ */
+template <typename TP, typename Iterator, typename KeyFunctor>
+std::vector<std::size_t> parallel_histogram(TP& thread_pool, Iterator first, Iterator last, std::size_t bins, KeyFunctor key_fn, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    std::vector<std::size_t> histogram(bins);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        if (!n || !bins) {
+            return histogram;
+        }
+
+        const std::size_t blocks = std::min(n, thread_pool.size());
+        const std::size_t stride = histogram_detail::padded_bins(bins);
+
+        // All the private bins, each block using its own cache lines
+        aligned_vector<std::size_t, cache_line_size> local(blocks * stride);
+
+        parallel_detail::for_each_block<KeyFunctor>(thread_pool, n, blocks, [first, bins, stride, &key_fn, counts = local.data()](std::size_t b, std::size_t i_first, std::size_t i_last) {
+            auto* block_counts = counts + b * stride;
+
+            auto it = first + i_first;
+            for (std::size_t i = i_first; i < i_last; ++i, ++it) {
+                const std::size_t bin = key_fn(*it);
+                cpp_assert(bin < bins, "parallel_histogram: bin out of range");
+                cpp_unused(bins);
+                ++block_counts[bin];
+            }
+        });
+
+        parallel_detail::for_each_block(thread_pool, bins, std::min(bins, thread_pool.size()), [blocks, stride, counts = local.data(), out = histogram.data()](std::size_t /*b*/, std::size_t b_first, std::size_t b_last) {
+            for (std::size_t block = 0; block < blocks; ++block) {
+                const auto* block_counts = counts + block * stride;
+
+                for (std::size_t bin = b_first; bin < b_last; ++bin) {
+                    out[bin] += block_counts[bin];
+                }
+            }
+        });
+    } else {
+        cpp_unused(thread_pool);
+
+        for (; first != last; ++first) {
+            const std::size_t bin = key_fn(*first);
+            cpp_assert(bin < bins, "parallel_histogram: bin out of range");
+            ++histogram[bin];
+        }
+    }
+
+    return histogram;
+}
+
+/*!
+ * \brief Compute, concurrently, the histogram of the given range.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param range The range of elements
+ * \param bins The number of bins
+ * \param key_fn The functor returning the bin, in [0, bins), of an element
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The count of each bin
+ */
+template <typename TP, typename Range, typename KeyFunctor>
+std::vector<std::size_t> parallel_histogram(TP& thread_pool, const Range& range, std::size_t bins, KeyFunctor key_fn, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_histogram(thread_pool, begin(range), end(range), bins, key_fn);
+}
+
+/*!
+ * \brief Count, concurrently, the number of elements of the range [first, last) per key.
+ *
+ * This is a hashed group-by count, for key spaces too large for
+ * parallel_histogram. Each block counts into private maps, one per
+ * partition of the hash space. Each partition is then merged by its own
+ * task, since the partitions contain disjoint keys, and the partitions
+ * are finally spliced into the result without copying the nodes.
+ *
+ * String-like keys (std::string, std::string_view, const char*) are
+ * counted in a string_hash_map, without building a string for keys
+ * already counted.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param key_fn The functor returning the key of an element
+ * \param location The location of the call, naming the call site of the profiler
+ * \return A map from each key to its count
+ */
+template <typename TP, typename Iterator, typename KeyFunctor>
+auto parallel_count_by(TP& thread_pool, Iterator first, Iterator last, KeyFunctor key_fn, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using key_t    = std::decay_t<decltype(key_fn(*first))>;
+    using traits   = histogram_detail::count_map<key_t>;
+    using map_type = typename traits::type;
+
+    auto count = [](map_type& map, const auto& key) {
+        if (auto it = map.find(key); it != map.end()) {
+            ++it->second;
+        } else {
+            map.emplace(typename traits::key_type(key), 1);
+        }
+    };
+
+    map_type result;
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        if (!n) {
+            return result;
+        }
+
+        const std::size_t blocks     = std::min(n, thread_pool.size());
+        const std::size_t partitions = thread_pool.size();
+
+        // local[b * partitions + p] holds the keys of partition p seen by block b
+        std::vector<map_type> local(blocks * partitions);
+
+        parallel_detail::for_each_block(thread_pool, n, blocks, [first, partitions, &key_fn, &count, &local](std::size_t b, std::size_t i_first, std::size_t i_last) {
+            auto* maps = &local[b * partitions];
+            const auto hasher = maps[0].hash_function();
+
+            auto it = first + i_first;
+            for (std::size_t i = i_first; i < i_last; ++i, ++it) {
+                const auto& key = key_fn(*it);
+                count(maps[histogram_detail::partition(hasher(key), partitions)], key);
+            }
+        });
+
+        parallel_detail::for_each_block(thread_pool, partitions, partitions, [blocks, partitions, &local](std::size_t p, std::size_t /*first*/, std::size_t /*last*/) {
+            auto& merged = local[p];
+
+            for (std::size_t b = 1; b < blocks; ++b) {
+                auto& map = local[b * partitions + p];
+
+                // Splice the new keys and then add the counts of the remaining ones
+                merged.merge(map);
+
+                for (auto& [key, value] : map) {
+                    merged[key] += value;
+                }
+
+                map = map_type();
+            }
+        });
+
+        std::size_t size = 0;
+        for (std::size_t p = 0; p < partitions; ++p) {
+            size += local[p].size();
+        }
+
+        result.reserve(size);
+
+        for (std::size_t p = 0; p < partitions; ++p) {
+            result.merge(local[p]);
+        }
+    } else {
+        cpp_unused(thread_pool);
+
+        for (; first != last; ++first) {
+            count(result, key_fn(*first));
+        }
+    }
+
+    return result;
+}
+
+/*!
+ * \brief Count, concurrently, the number of elements of the given range per key.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param range The range of elements
+ * \param key_fn The functor returning the key of an element
+ * \param location The location of the call, naming the call site of the profiler
+ * \return A map from each key to its count
+ */
+template <typename TP, typename Range, typename KeyFunctor>
+auto parallel_count_by(TP& thread_pool, const Range& range, KeyFunctor key_fn, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_count_by(thread_pool, begin(range), end(range), key_fn);
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_HISTOGRAM_HPP
@@ -14,8 +14,13 @@
 #ifndef CPP_UTILS_MAYBE_PARALLEL_HPP
 #define CPP_UTILS_MAYBE_PARALLEL_HPP
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
 #include "algorithm.hpp"
 #include "parallel.hpp"
+#include "stop_watch.hpp"
 
 namespace cpp {
 
@@ -59,9 +64,12 @@ struct thread_pool<true> : default_thread_pool<> {
  * \param thread_pool The thread pool
  * \param container The container to iterate
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Container, typename Functor>
-void maybe_parallel_foreach(thread_pool<true>& thread_pool, const Container& container, Functor&& fun) {
+void maybe_parallel_foreach(thread_pool<true>& thread_pool, const Container& container, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach(thread_pool, container, std::forward<Functor>(fun));
 }
 
@@ -73,9 +81,12 @@ void maybe_parallel_foreach(thread_pool<true>& thread_pool, const Container& con
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Iterator, typename Functor>
-void maybe_parallel_foreach(thread_pool<true>& thread_pool, Iterator first, Iterator last, Functor&& fun) {
+void maybe_parallel_foreach(thread_pool<true>& thread_pool, Iterator first, Iterator last, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach(thread_pool, first, last, std::forward<Functor>(fun));
 }
 
@@ -86,9 +97,12 @@ void maybe_parallel_foreach(thread_pool<true>& thread_pool, Iterator first, Iter
  * \param thread_pool The thread pool
  * \param container The container to iterate
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Container, typename Functor>
-void maybe_parallel_foreach_i(thread_pool<true>& thread_pool, const Container& container, Functor&& fun) {
+void maybe_parallel_foreach_i(thread_pool<true>& thread_pool, const Container& container, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach_i(thread_pool, container, std::forward<Functor>(fun));
 }
 
@@ -100,9 +114,12 @@ void maybe_parallel_foreach_i(thread_pool<true>& thread_pool, const Container& c
  * \param it The beginning of the range
  * \param end The end of the range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Iterator, typename Functor>
-void maybe_parallel_foreach_i(thread_pool<true>& thread_pool, Iterator it, Iterator end, Functor&& fun) {
+void maybe_parallel_foreach_i(thread_pool<true>& thread_pool, Iterator it, Iterator end, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach_i(thread_pool, it, end, std::forward<Functor>(fun));
 }
 
@@ -116,9 +133,12 @@ void maybe_parallel_foreach_i(thread_pool<true>& thread_pool, Iterator it, Itera
  * \param iit The beginning of the second range
  * \param ilast The end of the second range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Iterator, typename Iterator2, typename Functor>
-void maybe_parallel_foreach_pair_i(thread_pool<true>& thread_pool, Iterator it, Iterator end, Iterator2 iit, Iterator2 ilast, Functor&& fun) {
+void maybe_parallel_foreach_pair_i(thread_pool<true>& thread_pool, Iterator it, Iterator end, Iterator2 iit, Iterator2 ilast, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach_pair_i(thread_pool, it, end, iit, ilast, std::forward<Functor>(fun));
 }
 
@@ -130,12 +150,82 @@ void maybe_parallel_foreach_pair_i(thread_pool<true>& thread_pool, Iterator it,
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Functor>
-void maybe_parallel_foreach_n(thread_pool<true>& thread_pool, std::size_t first, std::size_t last, Functor&& fun) {
+void maybe_parallel_foreach_n(thread_pool<true>& thread_pool, std::size_t first, std::size_t last, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach_n(thread_pool, first, last, std::forward<Functor>(fun));
 }
 
+/*!
+ * \brief Copy the elements of the given range for which pred returns
+ * true, in parallel if the thread pool is parallel, sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out The beginning of the output range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The end of the output range
+ */
+template <typename Iterator, typename OutputIterator, typename Predicate>
+OutputIterator maybe_parallel_copy_if(thread_pool<true>& thread_pool, Iterator first, Iterator last, OutputIterator out, Predicate&& pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_copy_if(thread_pool, first, last, out, std::forward<Predicate>(pred));
+}
+
+/*!
+ * \brief Copy the elements of the given range into two ranges depending
+ * on pred, in parallel if the thread pool is parallel, sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out_true The beginning of the output range for the elements satisfying pred
+ * \param out_false The beginning of the output range for the other elements
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The ends of the two output ranges
+ */
+template <typename Iterator, typename OutputIterator1, typename OutputIterator2, typename Predicate>
+std::pair<OutputIterator1, OutputIterator2> maybe_parallel_partition_copy(thread_pool<true>& thread_pool, Iterator first, Iterator last, OutputIterator1 out_true, OutputIterator2 out_false, Predicate&& pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_partition_copy(thread_pool, first, last, out_true, out_false, std::forward<Predicate>(pred));
+}
+
+/*!
+ * \brief Remove the elements of the given range for which pred returns
+ * true, in parallel if the thread pool is parallel, sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The new end of the range
+ */
+template <typename Iterator, typename Predicate>
+Iterator maybe_parallel_remove_if(thread_pool<true>& thread_pool, Iterator first, Iterator last, Predicate&& pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_remove_if(thread_pool, first, last, std::forward<Predicate>(pred));
+}
+
+/*!
+ * \brief Apply the given function to the elements at the same position in
+ * all the given ranges, in parallel if the thread pool is parallel,
+ * sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param fun The functor to apply
+ * \param ranges The ranges to iterate
+ */
+template <typename Functor, typename... Ranges>
+void maybe_parallel_foreach_zip(thread_pool<true>& thread_pool, Functor&& fun, Ranges&&... ranges) {
+    parallel_foreach_zip(thread_pool, std::forward<Functor>(fun), std::forward<Ranges>(ranges)...);
+}
+
 //non-parallel versions
 
 /*!
@@ -145,9 +235,10 @@ void maybe_parallel_foreach_n(thread_pool<true>& thread_pool, std::size_t first,
  * \param thread_pool The thread pool
  * \param container The container to iterate
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Container, typename Functor>
-void maybe_parallel_foreach(thread_pool<false>& thread_pool, const Container& container, Functor&& fun) {
+void maybe_parallel_foreach(thread_pool<false>& thread_pool, const Container& container, Functor&& fun, [[maybe_unused]] call_site location = {}) {
     cpp_unused(thread_pool);
     foreach (container, fun);
 }
@@ -160,9 +251,10 @@ void maybe_parallel_foreach(thread_pool<false>& thread_pool, const Container& co
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Iterator, typename Functor>
-void maybe_parallel_foreach(thread_pool<false>& thread_pool, Iterator first, Iterator last, Functor&& fun) {
+void maybe_parallel_foreach(thread_pool<false>& thread_pool, Iterator first, Iterator last, Functor&& fun, [[maybe_unused]] call_site location = {}) {
     cpp_unused(thread_pool);
 
     foreach (first, last, fun);
@@ -175,9 +267,10 @@ void maybe_parallel_foreach(thread_pool<false>& thread_pool, Iterator first, Ite
  * \param thread_pool The thread pool
  * \param container The container to iterate
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Container, typename Functor>
-void maybe_parallel_foreach_i(thread_pool<false>& thread_pool, const Container& container, Functor&& fun) {
+void maybe_parallel_foreach_i(thread_pool<false>& thread_pool, const Container& container, Functor&& fun, [[maybe_unused]] call_site location = {}) {
     cpp_unused(thread_pool);
     foreach_i(container, fun);
 }
@@ -190,9 +283,10 @@ void maybe_parallel_foreach_i(thread_pool<false>& thread_pool, const Container&
  * \param it The beginning of the range
  * \param end The end of the range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Iterator, typename Functor>
-void maybe_parallel_foreach_i(thread_pool<false>& thread_pool, Iterator it, Iterator end, Functor&& fun) {
+void maybe_parallel_foreach_i(thread_pool<false>& thread_pool, Iterator it, Iterator end, Functor&& fun, [[maybe_unused]] call_site location = {}) {
     cpp_unused(thread_pool);
     foreach_i(it, end, fun);
 }
@@ -207,9 +301,10 @@ void maybe_parallel_foreach_i(thread_pool<false>& thread_pool, Iterator it, Iter
  * \param iit The beginning of the second range
  * \param ilast The end of the second range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename Iterator, typename Iterator2, typename Functor>
-void maybe_parallel_foreach_pair_i(thread_pool<false>& thread_pool, Iterator it, Iterator end, Iterator2 iit, Iterator2 ilast, Functor&& fun) {
+void maybe_parallel_foreach_pair_i(thread_pool<false>& thread_pool, Iterator it, Iterator end, Iterator2 iit, Iterator2 ilast, Functor&& fun, [[maybe_unused]] call_site location = {}) {
     cpp_unused(thread_pool);
     cpp_unused(ilast);
 
@@ -226,14 +321,377 @@ void maybe_parallel_foreach_pair_i(thread_pool<false>& thread_pool, Iterator it,
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename functor>
-void maybe_parallel_foreach_n(thread_pool<false>& thread_pool, std::size_t first, std::size_t last, functor&& fun) {
+void maybe_parallel_foreach_n(thread_pool<false>& thread_pool, std::size_t first, std::size_t last, functor&& fun, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
+
+    foreach_n(first, last, fun);
+}
+
+/*!
+ * \brief Copy the elements of the given range for which pred returns
+ * true, in parallel if the thread pool is parallel, sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out The beginning of the output range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The end of the output range
+ */
+template <typename Iterator, typename OutputIterator, typename Predicate>
+OutputIterator maybe_parallel_copy_if(thread_pool<false>& thread_pool, Iterator first, Iterator last, OutputIterator out, Predicate&& pred, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
+    return std::copy_if(first, last, out, std::forward<Predicate>(pred));
+}
+
+/*!
+ * \brief Copy the elements of the given range into two ranges depending
+ * on pred, in parallel if the thread pool is parallel, sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out_true The beginning of the output range for the elements satisfying pred
+ * \param out_false The beginning of the output range for the other elements
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The ends of the two output ranges
+ */
+template <typename Iterator, typename OutputIterator1, typename OutputIterator2, typename Predicate>
+std::pair<OutputIterator1, OutputIterator2> maybe_parallel_partition_copy(thread_pool<false>& thread_pool, Iterator first, Iterator last, OutputIterator1 out_true, OutputIterator2 out_false, Predicate&& pred, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
+    return std::partition_copy(first, last, out_true, out_false, std::forward<Predicate>(pred));
+}
+
+/*!
+ * \brief Remove the elements of the given range for which pred returns
+ * true, in parallel if the thread pool is parallel, sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The new end of the range
+ */
+template <typename Iterator, typename Predicate>
+Iterator maybe_parallel_remove_if(thread_pool<false>& thread_pool, Iterator first, Iterator last, Predicate&& pred, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
+    return std::remove_if(first, last, std::forward<Predicate>(pred));
+}
+
+/*!
+ * \brief Apply the given function to the elements at the same position in
+ * all the given ranges, in parallel if the thread pool is parallel,
+ * sequentially otherwise.
+ * \param thread_pool The thread pool
+ * \param fun The functor to apply
+ * \param ranges The ranges to iterate
+ */
+template <typename Functor, typename... Ranges>
+void maybe_parallel_foreach_zip(thread_pool<false>& thread_pool, Functor&& fun, Ranges&&... ranges) {
+    cpp_unused(thread_pool);
+    foreach_zip(std::forward<Functor>(fun), std::forward<Ranges>(ranges)...);
+}
+
+//adaptive versions
+
+/*!
+ * \brief The state of an adaptive parallel call site.
+ *
+ * The site learns, from the timings of its previous calls, the cost of
+ * processing one element and the overhead of dispatching one chunk to the
+ * thread pool. It then models the duration of a serial run as c * n and
+ * the duration of a parallel run with k chunks as d * k + c * n / k and
+ * chooses the fastest option: a serial run (0 chunk) or a parallel run
+ * with the best number of chunks.
+ *
+ * Every explore_period calls that would run serially, a parallel run is
+ * made instead to refresh the estimate of the dispatch overhead.
+ *
+ * The site can be used concurrently, the estimates are updated with
+ * relaxed atomic operations.
+ */
+struct adaptive_site {
+    static constexpr std::size_t explore_period = 64; ///< The period of the exploration of parallel runs
+
+    /*!
+     * \brief Returns the number of chunks to use for the given number of
+     * elements, 0 for a serial run.
+     * \param n The number of elements
+     * \param max_chunks The maximum number of chunks (the number of threads)
+     */
+    std::size_t choose_chunks(std::size_t n, std::size_t max_chunks) {
+        if (n < 2 || max_chunks < 2) {
+            return 0;
+        }
+
+        const double c = element_cost.load(std::memory_order_relaxed);
+        const double d = dispatch_cost.load(std::memory_order_relaxed);
+
+        // Nothing is known yet, a parallel run measures both costs
+        if (c == 0.0 || d == 0.0) {
+            return std::min(n, max_chunks);
+        }
+
+        const double best = std::sqrt(c * n / d);
+        const auto k      = std::min({n, max_chunks, std::max(std::size_t(2), static_cast<std::size_t>(std::lround(best)))});
+
+        if (d * k + c * n / k < c * n) {
+            return k;
+        }
+
+        if (calls.fetch_add(1, std::memory_order_relaxed) % explore_period == explore_period - 1) {
+            return std::min(n, max_chunks);
+        }
+
+        return 0;
+    }
+
+    /*!
+     * \brief Record the duration of a serial run
+     * \param n The number of elements
+     * \param ns The duration of the run, in nanoseconds
+     */
+    void record_serial(std::size_t n, double ns) {
+        if (n) {
+            update(element_cost, ns / n);
+        }
+    }
+
+    /*!
+     * \brief Record the duration of a parallel run
+     * \param n The number of elements
+     * \param k The number of chunks
+     * \param ns The duration of the run, in nanoseconds
+     * \param busy_ns The sum of the durations of the chunks, in nanoseconds
+     * \param critical_ns The duration of the longest chunk, in nanoseconds
+     */
+    void record_parallel(std::size_t n, std::size_t k, double ns, double busy_ns, double critical_ns) {
+        update(element_cost, busy_ns / n);
+        update(dispatch_cost, std::max(1.0, ns - critical_ns) / k);
+    }
+
+    /*!
+     * \brief Returns the current estimate of the cost of one element, in nanoseconds
+     */
+    double element_ns() const {
+        return element_cost.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * \brief Returns the current estimate of the cost of dispatching one chunk, in nanoseconds
+     */
+    double dispatch_ns() const {
+        return dispatch_cost.load(std::memory_order_relaxed);
+    }
+
+private:
+    static void update(std::atomic<double>& estimate, double sample) {
+        // Exponentially weighted moving average
+        const double old = estimate.load(std::memory_order_relaxed);
+        estimate.store(old == 0.0 ? sample : 0.75 * old + 0.25 * sample, std::memory_order_relaxed);
+    }
+
+    std::atomic<double> element_cost{0.0};  ///< The estimated cost of one element (ns)
+    std::atomic<double> dispatch_cost{0.0}; ///< The estimated cost of dispatching one chunk (ns)
+    std::atomic<std::size_t> calls{0};       ///< The number of serial decisions, for exploration
+};
+
+namespace maybe_parallel_detail {
+
+/*!
+ * \brief Returns the duration between two points of time in nanoseconds
+ */
+inline double ns_between(clock_type::time_point start, clock_type::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/*!
+ * \brief Atomically raise the given maximum to value
+ */
+inline void atomic_max(std::atomic<double>& max, double value) {
+    double current = max.load(std::memory_order_relaxed);
+    while (current < value && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
+
+/*!
+ * \brief Atomically add value to the given sum
+ */
+inline void atomic_add(std::atomic<double>& sum, double value) {
+    double current = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {}
+}
+
+} //end of namespace maybe_parallel_detail
+
+/*!
+ * \brief Apply the given function to each position in the given range,
+ * serially or in parallel depending on what the given site has learned
+ * to be the fastest for this number of elements.
+ * \param thread_pool The thread pool
+ * \param site The adaptive state of the call site
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Functor>
+void adaptive_parallel_foreach_n(thread_pool<true>& thread_pool, adaptive_site& site, std::size_t first, std::size_t last, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    const std::size_t n = last - first;
+    const auto k        = site.choose_chunks(n, thread_pool.size());
+
+    const auto start = clock_type::now();
+
+    if (!k) {
+        foreach_n(first, last, fun);
+        site.record_serial(n, maybe_parallel_detail::ns_between(start, clock_type::now()));
+        return;
+    }
+
+    std::atomic<double> busy{0.0};
+    std::atomic<double> critical{0.0};
+
+    parallel_detail::for_each_block<std::decay_t<Functor>>(thread_pool, n, k, [first, &fun, &busy, &critical](std::size_t /*b*/, std::size_t b_first, std::size_t b_last) {
+        const auto chunk_start = clock_type::now();
+
+        for (std::size_t i = first + b_first; i < first + b_last; ++i) {
+            fun(i);
+        }
+
+        const auto duration = maybe_parallel_detail::ns_between(chunk_start, clock_type::now());
+        maybe_parallel_detail::atomic_add(busy, duration);
+        maybe_parallel_detail::atomic_max(critical, duration);
+    });
+
+    site.record_parallel(n, k, maybe_parallel_detail::ns_between(start, clock_type::now()), busy.load(), critical.load());
+}
+
+/*!
+ * \brief Apply the given function to each position in the given range,
+ * serially or in parallel depending on what the call site has learned
+ * to be the fastest for this number of elements.
+ *
+ * The state is shared by all the calls with the same type of functor,
+ * which means one state per call site when the functor is a lambda.
+ *
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Functor>
+void adaptive_parallel_foreach_n(thread_pool<true>& thread_pool, std::size_t first, std::size_t last, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    static adaptive_site site;
+    adaptive_parallel_foreach_n(thread_pool, site, first, last, std::forward<Functor>(fun));
+}
+
+/*!
+ * \brief Apply the given function to each element of the given random
+ * access range, serially or in parallel depending on what the given site
+ * has learned to be the fastest for this number of elements.
+ * \param thread_pool The thread pool
+ * \param site The adaptive state of the call site
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Iterator, typename Functor>
+void adaptive_parallel_foreach(thread_pool<true>& thread_pool, adaptive_site& site, Iterator first, Iterator last, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    adaptive_parallel_foreach_n(thread_pool, site, 0, std::distance(first, last), [first, &fun](std::size_t i) { fun(first[i]); });
+}
+
+/*!
+ * \brief Apply the given function to each element of the given random
+ * access range, serially or in parallel depending on what the call site
+ * has learned to be the fastest for this number of elements.
+ *
+ * The state is shared by all the calls with the same type of functor,
+ * which means one state per call site when the functor is a lambda.
+ *
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Iterator, typename Functor>
+void adaptive_parallel_foreach(thread_pool<true>& thread_pool, Iterator first, Iterator last, Functor&& fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    static adaptive_site site;
+    adaptive_parallel_foreach(thread_pool, site, first, last, std::forward<Functor>(fun));
+}
+
+/*!
+ * \brief Apply the given function to each position in the given range, sequentially.
+ * \param thread_pool The thread pool
+ * \param site The adaptive state of the call site
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Functor>
+void adaptive_parallel_foreach_n(thread_pool<false>& thread_pool, adaptive_site& site, std::size_t first, std::size_t last, Functor&& fun, [[maybe_unused]] call_site location = {}) {
     cpp_unused(thread_pool);
+    cpp_unused(site);
+    foreach_n(first, last, fun);
+}
 
+/*!
+ * \brief Apply the given function to each position in the given range, sequentially.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Functor>
+void adaptive_parallel_foreach_n(thread_pool<false>& thread_pool, std::size_t first, std::size_t last, Functor&& fun, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
     foreach_n(first, last, fun);
 }
 
+/*!
+ * \brief Apply the given function to each element of the given range, sequentially.
+ * \param thread_pool The thread pool
+ * \param site The adaptive state of the call site
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Iterator, typename Functor>
+void adaptive_parallel_foreach(thread_pool<false>& thread_pool, adaptive_site& site, Iterator first, Iterator last, Functor&& fun, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
+    cpp_unused(site);
+    foreach (first, last, fun);
+}
+
+/*!
+ * \brief Apply the given function to each element of the given range, sequentially.
+ * \param thread_pool The thread pool
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename Iterator, typename Functor>
+void adaptive_parallel_foreach(thread_pool<false>& thread_pool, Iterator first, Iterator last, Functor&& fun, [[maybe_unused]] call_site location = {}) {
+    cpp_unused(thread_pool);
+    foreach (first, last, fun);
+}
+
 } //end of dll namespace
 
 #endif
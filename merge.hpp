@@ -0,0 +1,420 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file merge.hpp
+ * \brief Contains serial and parallel merge algorithms for sorted runs.
+ *
+ * The parallel merges split the output into one range per thread and
+ * find, for each output range, the corresponding input ranges (co-ranking)
+ * with a binary search, the merge path. Each range is then merged
+ * independently. All the merges are stable: equal elements are output in
+ * the order of their runs.
+ */
+
+#ifndef CPP_UTILS_MERGE_HPP
+#define CPP_UTILS_MERGE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace cpp {
+
+namespace merge_detail {
+
+/*!
+ * \brief Returns the number of elements of [a, a + m) among the first k
+ * elements of the stable merge of [a, a + m) and [b, b + n).
+ *
+ * This is the intersection of the merge path with the k-th cross
+ * diagonal, found with a binary search.
+ */
+template <typename Iterator1, typename Iterator2, typename Compare>
+std::size_t co_rank(std::size_t k, Iterator1 a, std::size_t m, Iterator2 b, std::size_t n, Compare& comp) {
+    std::size_t lo = k > n ? k - n : 0;
+    std::size_t hi = std::min(k, m);
+
+    while (lo < hi) {
+        const std::size_t i = lo + (hi - lo) / 2;
+        const std::size_t j = k - i;
+
+        // a[i] comes before b[j - 1], so more elements of a are taken
+        if (!comp(b[j - 1], a[i])) {
+            lo = i + 1;
+        } else {
+            hi = i;
+        }
+    }
+
+    return lo;
+}
+
+/*!
+ * \brief Returns the split of each run such that the splits contain the
+ * first k elements of the stable merge of the runs.
+ *
+ * This is a multi-sequence selection: the elements are ordered by value
+ * and then by run, the search narrows a window of candidate splits per
+ * run by ranking the middle element of the largest window in all runs.
+ */
+template <typename Iterator, typename Compare>
+std::vector<std::size_t> multi_select(const std::vector<std::pair<Iterator, Iterator>>& runs, std::size_t k, Compare& comp) {
+    const std::size_t r = runs.size();
+
+    std::vector<std::size_t> lo(r, 0);
+    std::vector<std::size_t> hi(r);
+    std::vector<std::size_t> rank(r);
+
+    for (std::size_t q = 0; q < r; ++q) {
+        hi[q] = std::distance(runs[q].first, runs[q].second);
+    }
+
+    while (true) {
+        // Select the pivot in the middle of the largest window
+        std::size_t p = 0;
+        for (std::size_t q = 1; q < r; ++q) {
+            if (hi[q] - lo[q] > hi[p] - lo[p]) {
+                p = q;
+            }
+        }
+
+        if (!r || lo[p] == hi[p]) {
+            return lo;
+        }
+
+        const std::size_t i = lo[p] + (hi[p] - lo[p]) / 2;
+        const auto& pivot   = runs[p].first[i];
+
+        // Count the elements before the pivot, in (value, run) order
+        std::size_t before = 0;
+        for (std::size_t q = 0; q < r; ++q) {
+            if (q == p) {
+                rank[q] = i;
+            } else if (q < p) {
+                rank[q] = std::distance(runs[q].first, std::upper_bound(runs[q].first, runs[q].second, pivot, comp));
+            } else {
+                rank[q] = std::distance(runs[q].first, std::lower_bound(runs[q].first, runs[q].second, pivot, comp));
+            }
+
+            before += rank[q];
+        }
+
+        if (before == k) {
+            return rank;
+        }
+
+        if (before < k) {
+            // The pivot and all the elements before it are selected
+            for (std::size_t q = 0; q < r; ++q) {
+                lo[q] = std::max(lo[q], rank[q]);
+            }
+
+            lo[p] = i + 1;
+        } else {
+            // The pivot and all the elements after it are not selected
+            for (std::size_t q = 0; q < r; ++q) {
+                hi[q] = std::min(hi[q], rank[q]);
+            }
+        }
+    }
+}
+
+/*!
+ * \brief A loser tree over sorted runs.
+ *
+ * Each internal node of the tournament tree stores the loser of the match
+ * played at this node and the root stores the overall winner. Replacing
+ * the winner by the next element of its run replays only the matches on
+ * the path from its leaf to the root, with log2(k) comparisons.
+ */
+template <typename Iterator, typename Compare>
+struct loser_tree {
+    /*!
+     * \brief Build the tree over the given runs
+     */
+    loser_tree(const std::vector<std::pair<Iterator, Iterator>>& runs, Compare& comp)
+            : runs(runs), comp(comp), leaves(std::bit_ceil(std::max(runs.size(), std::size_t(1)))), tree(leaves) {
+        for (auto& run : runs) {
+            cursors.push_back(run.first);
+        }
+
+        tree[0] = build(1);
+    }
+
+    /*!
+     * \brief Indicates if all the runs are exhausted
+     */
+    bool empty() const {
+        return exhausted(tree[0]);
+    }
+
+    /*!
+     * \brief Returns the run holding the smallest element
+     */
+    std::size_t top() const {
+        return tree[0];
+    }
+
+    /*!
+     * \brief Returns an iterator to the smallest element
+     */
+    Iterator top_element() const {
+        return cursors[tree[0]];
+    }
+
+    /*!
+     * \brief Remove the smallest element
+     */
+    void pop() {
+        std::size_t winner = tree[0];
+        ++cursors[winner];
+
+        for (std::size_t node = (winner + leaves) / 2; node > 0; node /= 2) {
+            if (beats(tree[node], winner)) {
+                std::swap(tree[node], winner);
+            }
+        }
+
+        tree[0] = winner;
+    }
+
+private:
+    bool exhausted(std::size_t run) const {
+        return run >= cursors.size() || cursors[run] == runs[run].second;
+    }
+
+    bool beats(std::size_t a, std::size_t b) const {
+        if (exhausted(a)) {
+            return false;
+        }
+
+        if (exhausted(b)) {
+            return true;
+        }
+
+        if (comp(*cursors[a], *cursors[b])) {
+            return true;
+        }
+
+        return !comp(*cursors[b], *cursors[a]) && a < b;
+    }
+
+    std::size_t build(std::size_t node) {
+        if (node >= leaves) {
+            return node - leaves;
+        }
+
+        const std::size_t left  = build(2 * node);
+        const std::size_t right = build(2 * node + 1);
+
+        if (beats(left, right)) {
+            tree[node] = right;
+            return left;
+        }
+
+        tree[node] = left;
+        return right;
+    }
+
+    const std::vector<std::pair<Iterator, Iterator>>& runs; ///< The runs
+    Compare& comp;                                          ///< The comparison functor
+    const std::size_t leaves;                               ///< The number of leaves, a power of two
+    std::vector<std::size_t> tree;                          ///< The losers of the matches, the winner at 0
+    std::vector<Iterator> cursors;                          ///< The current position in each run
+};
+
+/*!
+ * \brief Merge the given runs into out with a loser tree
+ */
+template <typename Iterator, typename OutputIterator, typename Compare>
+OutputIterator k_way_merge(const std::vector<std::pair<Iterator, Iterator>>& runs, OutputIterator out, Compare& comp) {
+    if (runs.size() == 1) {
+        return std::copy(runs[0].first, runs[0].second, out);
+    }
+
+    if (runs.size() == 2) {
+        return std::merge(runs[0].first, runs[0].second, runs[1].first, runs[1].second, out, comp);
+    }
+
+    loser_tree<Iterator, Compare> tree(runs, comp);
+
+    while (!tree.empty()) {
+        *out = *tree.top_element();
+        ++out;
+        tree.pop();
+    }
+
+    return out;
+}
+
+} //end of namespace merge_detail
+
+/*!
+ * \brief Merge, concurrently, the two sorted ranges [first_1, last_1) and [first_2, last_2) into out.
+ *
+ * The output is split into one range per thread and the corresponding
+ * input ranges are found with a binary search on the merge path. The
+ * merge is stable. When a range is not random access, std::merge is used.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first_1 The beginning of the first range
+ * \param last_1 The end of the first range
+ * \param first_2 The beginning of the second range
+ * \param last_2 The end of the second range
+ * \param out The beginning of the output range
+ * \param comp The comparison functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last written element
+ */
+template <typename TP, typename Iterator1, typename Iterator2, typename OutputIterator, typename Compare>
+OutputIterator parallel_merge(TP& thread_pool, Iterator1 first_1, Iterator1 last_1, Iterator2 first_2, Iterator2 last_2, OutputIterator out, Compare comp, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator1> && parallel_detail::is_random_access<Iterator2> && parallel_detail::is_random_access<OutputIterator>) {
+        const std::size_t m = std::distance(first_1, last_1);
+        const std::size_t n = std::distance(first_2, last_2);
+
+        if (m + n) {
+            parallel_detail::for_each_block(thread_pool, m + n, std::min(m + n, thread_pool.size()), [=, &comp](std::size_t /*b*/, std::size_t first, std::size_t last) {
+                const std::size_t i_first = merge_detail::co_rank(first, first_1, m, first_2, n, comp);
+                const std::size_t i_last  = merge_detail::co_rank(last, first_1, m, first_2, n, comp);
+
+                std::merge(first_1 + i_first, first_1 + i_last, first_2 + (first - i_first), first_2 + (last - i_last), out + first, comp);
+            });
+        }
+
+        return out + (m + n);
+    } else {
+        cpp_unused(thread_pool);
+        return std::merge(first_1, last_1, first_2, last_2, out, comp);
+    }
+}
+
+/*!
+ * \brief Merge, concurrently, the two sorted ranges [first_1, last_1) and [first_2, last_2) into out, in ascending order.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first_1 The beginning of the first range
+ * \param last_1 The end of the first range
+ * \param first_2 The beginning of the second range
+ * \param last_2 The end of the second range
+ * \param out The beginning of the output range
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last written element
+ */
+template <typename TP, typename Iterator1, typename Iterator2, typename OutputIterator>
+OutputIterator parallel_merge(TP& thread_pool, Iterator1 first_1, Iterator1 last_1, Iterator2 first_2, Iterator2 last_2, OutputIterator out, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_merge(thread_pool, first_1, last_1, first_2, last_2, out, std::less<>());
+}
+
+/*!
+ * \brief Merge the given sorted runs into out.
+ *
+ * The runs are merged at once with a loser tree, which needs log2(k)
+ * comparisons per element instead of the k - 1 passes of a chain of
+ * std::merge. The merge is stable, equal elements are output in the order
+ * of their runs.
+ *
+ * \param runs The sorted runs, as [first, last) pairs
+ * \param out The beginning of the output range
+ * \param comp The comparison functor
+ * \return An iterator past the last written element
+ */
+template <typename Iterator, typename OutputIterator, typename Compare>
+OutputIterator k_way_merge(const std::vector<std::pair<Iterator, Iterator>>& runs, OutputIterator out, Compare comp) {
+    if (runs.empty()) {
+        return out;
+    }
+
+    return merge_detail::k_way_merge(runs, out, comp);
+}
+
+/*!
+ * \brief Merge the given sorted runs into out, in ascending order.
+ * \param runs The sorted runs, as [first, last) pairs
+ * \param out The beginning of the output range
+ * \return An iterator past the last written element
+ */
+template <typename Iterator, typename OutputIterator>
+OutputIterator k_way_merge(const std::vector<std::pair<Iterator, Iterator>>& runs, OutputIterator out) {
+    return k_way_merge(runs, out, std::less<>());
+}
+
+/*!
+ * \brief Merge, concurrently, the given sorted runs into out.
+ *
+ * The output is split into one range per thread. The split of each run
+ * corresponding to the start of each output range is found by
+ * multi-sequence selection and each output range is then merged with a
+ * loser tree. The merge is stable. When the runs or the output are not
+ * random access, the runs are merged serially.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param runs The sorted runs, as [first, last) pairs
+ * \param out The beginning of the output range
+ * \param comp The comparison functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last written element
+ */
+template <typename TP, typename Iterator, typename OutputIterator, typename Compare>
+OutputIterator parallel_k_way_merge(TP& thread_pool, const std::vector<std::pair<Iterator, Iterator>>& runs, OutputIterator out, Compare comp, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && parallel_detail::is_random_access<OutputIterator>) {
+        std::size_t n = 0;
+        for (auto& run : runs) {
+            n += std::distance(run.first, run.second);
+        }
+
+        if (n) {
+            parallel_detail::for_each_block(thread_pool, n, std::min(n, thread_pool.size()), [&runs, out, &comp](std::size_t /*b*/, std::size_t first, std::size_t last) {
+                const auto starts = merge_detail::multi_select(runs, first, comp);
+                const auto ends   = merge_detail::multi_select(runs, last, comp);
+
+                std::vector<std::pair<Iterator, Iterator>> sub_runs;
+                for (std::size_t q = 0; q < runs.size(); ++q) {
+                    if (starts[q] != ends[q]) {
+                        sub_runs.emplace_back(runs[q].first + starts[q], runs[q].first + ends[q]);
+                    }
+                }
+
+                merge_detail::k_way_merge(sub_runs, out + first, comp);
+            });
+        }
+
+        return out + n;
+    } else {
+        cpp_unused(thread_pool);
+        return k_way_merge(runs, out, comp);
+    }
+}
+
+/*!
+ * \brief Merge, concurrently, the given sorted runs into out, in ascending order.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param runs The sorted runs, as [first, last) pairs
+ * \param out The beginning of the output range
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator past the last written element
+ */
+template <typename TP, typename Iterator, typename OutputIterator>
+OutputIterator parallel_k_way_merge(TP& thread_pool, const std::vector<std::pair<Iterator, Iterator>>& runs, OutputIterator out, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_k_way_merge(thread_pool, runs, out, std::less<>());
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_MERGE_HPP
@@ -20,9 +20,26 @@
 #include <vector>
 #include <functional>
 #include <algorithm>
-
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <source_location>
+#include <type_traits>
+
+#include "algorithm.hpp"
 #include "assert.hpp"
+#include "bitset.hpp"
+#include "task_group.hpp"
+#include "thread_pool.hpp"
 #include "tmp.hpp"
+#include "views.hpp"
+
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+#include "parallel_profile.hpp"
+#endif
 
 namespace cpp {
 
@@ -39,53 +56,412 @@ void with_lock(Lock& lock, Functor fun) {
     fun();
 }
 
-//1. Normal versions (no thread pool)
+/*!
+ * \brief A functor declared as never throwing.
+ *
+ * The parallel algorithms capture the exceptions of the functors to
+ * rethrow them on the calling thread. Passing a nothrow_functor (see
+ * assume_nothrow()) skips this capture. If the functor throws anyway,
+ * std::terminate is called.
+ */
+template <typename Functor>
+struct nothrow_functor {
+    Functor fun; ///< The wrapped functor
+
+    /*!
+     * \brief Call the wrapped functor
+     */
+    template <typename... Args>
+    decltype(auto) operator()(Args&&... args) noexcept {
+        return fun(std::forward<Args>(args)...);
+    }
+
+    /*!
+     * \brief Call the wrapped functor
+     */
+    template <typename... Args>
+    decltype(auto) operator()(Args&&... args) const noexcept {
+        return fun(std::forward<Args>(args)...);
+    }
+};
 
 /*!
- * \brief Applies the given functor, concurrently, to the result of dereferencing every iterator in the range [first, last).
+ * \brief Declare the given functor as never throwing (see nothrow_functor).
+ * \param fun The functor
+ * \return The functor wrapped in a nothrow_functor
+ */
+template <typename Functor>
+nothrow_functor<Functor> assume_nothrow(Functor fun) {
+    return {std::move(fun)};
+}
+
+/*!
+ * \brief The location of the call of a parallel algorithm.
+ *
+ * The thread pool algorithms take it as their last parameter, defaulted to
+ * the location of their caller. When CPP_UTILS_PARALLEL_PROFILE is defined,
+ * it names the call site of the profiler (see parallel_profile.hpp).
+ * Otherwise, it is empty and nothing is captured.
+ */
+struct call_site {
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+    /*!
+     * \brief Construct the call site at the given location, the location of the caller by default
+     */
+    call_site(const std::source_location& location = std::source_location::current()) : location(location) {
+        //Nothing else to init
+    }
+
+    std::source_location location; ///< The location of the call
+#endif
+};
+
+namespace parallel_detail {
+
+/*!
+ * \brief Indicates if the given functor type is a nothrow_functor
+ */
+template <typename Functor>
+constexpr bool is_nothrow_functor = false;
+
+/*!
+ * \copydoc is_nothrow_functor
+ */
+template <typename Functor>
+constexpr bool is_nothrow_functor<nothrow_functor<Functor>> = true;
+
+/*!
+ * \brief Makes the given call site the site of the parallel algorithms
+ * called by the current thread, unless an enclosing algorithm already set
+ * one. Does nothing unless CPP_UTILS_PARALLEL_PROFILE is defined.
+ */
+struct site_scope {
+    /*!
+     * \brief Enter the given call site
+     */
+    explicit site_scope([[maybe_unused]] const call_site& site) {
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+        if (!saved) {
+            parallel_profile_detail::current_site = &site.location;
+        }
+#endif
+    }
+
+    site_scope(const site_scope& rhs) = delete;
+    site_scope& operator=(const site_scope& rhs) = delete;
+
+    /*!
+     * \brief Leave the call site
+     */
+    ~site_scope() {
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+        parallel_profile_detail::current_site = saved;
+#endif
+    }
+
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+private:
+    const std::source_location* const saved = parallel_profile_detail::current_site; ///< The enclosing call site
+#endif
+};
+
+/*!
+ * \brief The state of one call of a parallel algorithm, shared by its tasks.
+ *
+ * The first exception thrown by a task is kept and the tasks not yet
+ * started are cancelled. The exception is rethrown by the calling thread
+ * once all the tasks are done.
+ *
+ * When CPP_UTILS_PARALLEL_PROFILE is defined, it also holds the profile of
+ * the call (see parallel_profile.hpp).
+ */
+struct call_state {
+    std::atomic<bool> cancelled{false}; ///< Indicates if a task has thrown
+    std::exception_ptr error;           ///< The first exception thrown by a task
+    std::mutex lock;                    ///< The lock protecting error
+
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+    parallel_profile_detail::call profile; ///< The profile of the call
+#endif
+
+    /*!
+     * \brief Construct the state of a call of the algorithm at the given location
+     * \param location The location of the algorithm, naming the call site of the profiler
+     */
+    explicit call_state([[maybe_unused]] const std::source_location& location = std::source_location::current())
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+            : profile(location)
+#endif
+    {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Run the given functor, unless the call is cancelled, and
+     * capture its exception. The functors that cannot throw are directly
+     * called.
+     */
+    template <typename Functor, typename... Args>
+    void run(Functor& fun, Args&&... args) {
+#ifndef CPP_UTILS_NO_EXCEPT
+        if constexpr (std::is_nothrow_invocable_v<Functor&, Args...>) {
+            fun(std::forward<Args>(args)...);
+        } else {
+            if (cancelled.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            try {
+                fun(std::forward<Args>(args)...);
+            } catch (...) {
+                std::unique_lock<std::mutex> l(lock);
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+
+                cancelled.store(true, std::memory_order_relaxed);
+            }
+        }
+#else
+        fun(std::forward<Args>(args)...);
+#endif
+    }
+
+    /*!
+     * \brief Rethrow the first exception thrown by a task, if any. Must be
+     * called once all the tasks are done.
+     */
+    void rethrow() {
+#ifndef CPP_UTILS_NO_EXCEPT
+        if (error) {
+            std::rethrow_exception(error);
+        }
+#endif
+    }
+};
+
+/*!
+ * \brief Wrap a task of a parallel call so that its exception is captured
+ * in the state of the call, unless the functor of the user is a nothrow_functor.
+ * When profiling, the duration of the task is recorded.
+ * \tparam Functor The type of the functor of the user
+ * \param state The state of the call
+ * \param task The task to wrap
+ * \return The wrapped task
+ */
+template <typename Functor, typename Task>
+auto guard(call_state& state, Task task) {
+#ifdef CPP_UTILS_PARALLEL_PROFILE
+    return [&state, task](auto&&... args) mutable {
+        state.profile.time([&] { state.run(task, std::forward<decltype(args)>(args)...); });
+    };
+#else
+    if constexpr (is_nothrow_functor<Functor>) {
+        cpp_unused(state);
+        return task;
+    } else {
+        return [&state, task](auto&&... args) mutable {
+            state.run(task, std::forward<decltype(args)>(args)...);
+        };
+    }
+#endif
+}
+
+/*!
+ * \brief Indicates if the given iterator type is a random access iterator
+ */
+template <typename Iterator>
+constexpr bool is_random_access = std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>;
+
+/*!
+ * \brief Indicates if the given iterator type refers to packed bits through
+ * proxies (std::vector<bool>). Several elements share the same word, they
+ * cannot be written concurrently.
+ */
+template <typename Iterator>
+constexpr bool is_packed_bool = std::is_same_v<typename std::iterator_traits<Iterator>::value_type, bool> && !std::is_lvalue_reference_v<typename std::iterator_traits<Iterator>::reference>;
+
+/*!
+ * \brief Submit a task to the thread pool, preferably to the given worker.
+ *
+ * The thread pools supporting affinity (do_task_on) receive the task in
+ * the queue of the worker, the other ones in their shared queue. Always
+ * submitting the same part of a range to the same worker lets the
+ * successive loops over the same data reuse the caches of the workers.
+ * A task rejected by the thread pool is executed directly (see
+ * thread_pool_detail::do_task_or_run()).
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param worker The index of the preferred worker
+ * \param fun The functor to execute
+ * \param args The arguments to be passed to the functor
+ */
+template <typename TP, typename Functor, typename... Args>
+void submit(TP& thread_pool, std::size_t worker, Functor&& fun, Args&&... args) {
+    if constexpr (requires { thread_pool.try_do_task_on(worker, fun, args...); }) {
+        if (!thread_pool.try_do_task_on(worker, fun, args...)) {
+            fun(args...);
+        }
+    } else if constexpr (requires { thread_pool.do_task_on(worker, fun, args...); }) {
+        thread_pool.do_task_on(worker, std::forward<Functor>(fun), std::forward<Args>(args)...);
+    } else {
+        thread_pool_detail::do_task_or_run(thread_pool, std::forward<Functor>(fun), std::forward<Args>(args)...);
+    }
+}
+
+/*!
+ * \brief Split [0, n) into the given number of contiguous blocks of
+ * (almost) equal size and call fun(b, first, last) concurrently for each
+ * block b and its range [first, last). Wait for all the blocks to be done.
+ *
+ * Block b is submitted to the worker b (modulo the number of workers), so
+ * that successive calls over the same range process each block on the
+ * same worker.
+ *
+ * The first exception thrown by a block cancels the blocks not yet
+ * started and is rethrown once the other blocks are done.
+ *
+ * \tparam UserFunctor The type of the functor of the user called by the
+ * blocks. The exceptions of the blocks are not captured when it is a
+ * nothrow_functor, which is only valid if the blocks do nothing else that
+ * can throw.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param n The number of elements
+ * \param blocks The number of blocks
+ * \param fun The functor to apply to each block.
+ * \param location The location of the algorithm calling this function, for the profiler
+ */
+template <typename UserFunctor = void, typename TP, typename Functor>
+void for_each_block(TP& thread_pool, std::size_t n, std::size_t blocks, Functor fun, const std::source_location& location = std::source_location::current()) {
+    call_state state(location);
+
+    auto task = guard<UserFunctor>(state, fun);
+
+    for (std::size_t b = 0; b < blocks; ++b) {
+        submit(thread_pool, b, task, b, n * b / blocks, n * (b + 1) / blocks);
+    }
+
+    thread_pool.wait();
+
+    state.rethrow();
+}
+
+/*!
+ * \brief Call fun(i) concurrently for each i in [0, n) on the shared
+ * thread pool, with one block of indices per thread, and wait for them.
+ *
+ * Only the tasks of this call are waited for, the other users of the
+ * shared pool are not. The first block is executed by the calling thread.
+ * When called from a thread of the shared pool, the loop is executed
+ * serially since the enclosing parallel loop already uses the threads.
+ *
+ * \param n The number of indices
+ * \param fun The functor to apply.
+ */
+template <typename Functor>
+void shared_foreach_index(std::size_t n, Functor fun) {
+    auto& pool = shared_thread_pool();
+
+    const std::size_t blocks = std::min(n, pool.size());
+
+    if (blocks < 2 || pool.in_worker()) {
+        for (std::size_t i = 0; i < n; ++i) {
+            fun(i);
+        }
+
+        return;
+    }
+
+    auto block = [n, blocks](Functor& block_fun, std::size_t b) {
+        for (std::size_t i = n * b / blocks; i < n * (b + 1) / blocks; ++i) {
+            block_fun(i);
+        }
+    };
+
+    task_group group(pool);
+
+    // Each block works on its own copy of the functor
+    for (std::size_t b = 1; b < blocks; ++b) {
+        group.spawn([&block, b, fun]() mutable { block(fun, b); });
+    }
+
+    block(fun, 0);
+
+    group.sync();
+}
+
+/*!
+ * \brief Call fun(it, i) concurrently for each iterator it in [first, last)
+ * and its position i, on the shared thread pool, and wait for them.
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * Random access ranges are split in blocks (see shared_foreach_index), the
+ * other ones are submitted element by element.
  *
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply.
  */
 template <typename Iterator, typename Functor>
-void parallel_foreach(Iterator first, Iterator last, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(std::distance(first, last));
+void shared_foreach_it(Iterator first, Iterator last, Functor fun) {
+    if constexpr (is_random_access<Iterator>) {
+        shared_foreach_index(std::distance(first, last), [first, fun](std::size_t i) mutable { fun(first + i, i); });
+    } else {
+        auto& pool = shared_thread_pool();
+
+        if (pool.in_worker()) {
+            for (std::size_t i = 0; first != last; ++first, ++i) {
+                fun(first, i);
+            }
+
+            return;
+        }
+
+        task_group group(pool);
 
-    for (; first != last; ++first) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, *first)));
+        for (std::size_t i = 0; first != last; ++first, ++i) {
+            group.spawn([fun, first, i]() mutable { fun(first, i); });
+        }
+
+        group.sync();
     }
+}
 
-    //No need to wait for the futures, the destructor will do it for us
+} //end of namespace parallel_detail
+
+//1. Normal versions (no thread pool, the shared thread pool is used)
+
+/*!
+ * \brief Applies the given functor, concurrently, to the result of dereferencing every iterator in the range [first, last).
+ *
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
+ *
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The functor to apply.
+ */
+template <typename Iterator, typename Functor>
+void parallel_foreach(Iterator first, Iterator last, Functor fun) {
+    parallel_detail::shared_foreach_it(first, last, [fun](Iterator it, std::size_t /*i*/) mutable { fun(*it); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to each value in the given container.
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param container The container to iterate.
  * \param fun The functor to apply.
  */
 template <typename Container, typename Functor>
 void parallel_foreach(Container& container, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(container.size());
-
-    for (std::size_t i = 0; i < container.size(); ++i) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, container[i])));
-    }
-
-    //No need to wait for the futures, the destructor will do it for us
+    parallel_detail::shared_foreach_index(container.size(), [&container, fun](std::size_t i) mutable { fun(container[i]); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to the result of dereferencing every iterator in the range [first, last) and its position in the range. .
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param first The beginning of the range
  * \param last The end of the range
@@ -93,40 +469,26 @@ void parallel_foreach(Container& container, Functor fun) {
  */
 template <typename Iterator, typename Functor>
 void parallel_foreach_i(Iterator first, Iterator last, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(std::distance(first, last));
-
-    for (; first != last; ++first) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, *first, futures.size())));
-    }
-
-    //No need to wait for the futures, the destructor will do it for us
+    parallel_detail::shared_foreach_it(first, last, [fun](Iterator it, std::size_t i) mutable { fun(*it, i); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to every element in the given container and its position in the container. .
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param container The container to iterate.
  * \param fun The functor to apply.
  */
 template <typename Container, typename Functor>
 void parallel_foreach_i(Container& container, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(container.size());
-
-    for (std::size_t i = 0; i < container.size(); ++i) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, container[i], i)));
-    }
-
-    //No need to wait for the futures, the destructor will do it for us
+    parallel_detail::shared_foreach_index(container.size(), [&container, fun](std::size_t i) mutable { fun(container[i], i); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to each iterator in the range [first, last).
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param first The beginning of the range
  * \param last The end of the range
@@ -134,20 +496,13 @@ void parallel_foreach_i(Container& container, Functor fun) {
  */
 template <typename Iterator, typename Functor>
 void parallel_foreach_it(Iterator first, Iterator last, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(std::distance(first, last));
-
-    for (; first != last; ++first) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, first)));
-    }
-
-    //No need to wait for the futures, the destructor will do it for us
+    parallel_detail::shared_foreach_it(first, last, [fun](Iterator it, std::size_t /*i*/) mutable { fun(it); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to each iterator in the given container.
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param container The container to iterate.
  * \param fun The functor to apply.
@@ -163,7 +518,7 @@ void parallel_foreach_it(Container& container, Functor fun) {
 /*!
  * \brief Applies the given functor, concurrently, to each value in the range [first, last).
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param first The beginning of the range
  * \param last The end of the range
@@ -171,20 +526,13 @@ void parallel_foreach_it(Container& container, Functor fun) {
  */
 template <typename Functor>
 void parallel_foreach_n(std::size_t first, std::size_t last, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(last - first);
-
-    for (std::size_t i = first; i != last; ++i) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, i)));
-    }
-
-    //No need to wait for the futures, the destructor will do it for us
+    parallel_detail::shared_foreach_index(last - first, [first, fun](std::size_t i) mutable { fun(first + i); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to each index in the given range [first, last).
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param first The beginning of the range
  * \param last The end of the range
@@ -192,20 +540,13 @@ void parallel_foreach_n(std::size_t first, std::size_t last, Functor fun) {
  */
 template <typename Iterator, typename Functor>
 void parallel_foreach_i_only(Iterator first, Iterator last, Functor fun) {
-    std::vector<std::future<void>> futures;
-    futures.reserve(std::distance(first, last));
-
-    for (; first != last; ++first) {
-        futures.push_back(std::move(std::async(std::launch::async, fun, futures.size())));
-    }
-
-    //No need to wait for the futures, the destructor will do it for us
+    parallel_detail::shared_foreach_index(std::distance(first, last), [fun](std::size_t i) mutable { fun(i); });
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to each index in the given container.
  *
- * The number of threads used is chosen by the STL. The processing order is undefined.
+ * The jobs are executed by the shared thread pool (see shared_thread_pool()). The processing order is undefined.
  *
  * \param container The container to iterate.
  * \param fun The functor to apply.
@@ -228,61 +569,87 @@ void parallel_foreach_i_only(Container& container, Functor fun) {
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Iterator, typename Functor>
-void parallel_foreach(TP& thread_pool, Iterator first, Iterator last, Functor fun) {
+void parallel_foreach(TP& thread_pool, Iterator first, Iterator last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    parallel_detail::call_state state;
+
+    auto task = parallel_detail::guard<Functor>(state, fun);
+
     if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>) {
         auto n    = std::distance(first, last);
         auto part = n / thread_pool.size();
 
         if (part < 2) {
             for (; first != last; ++first) {
-                thread_pool.do_task(fun, *first);
+                thread_pool_detail::do_task_or_run(thread_pool, task, *first);
             }
         } else {
-            auto batch_functor = [fun](Iterator first, Iterator last) {
+            auto batch_functor = parallel_detail::guard<Functor>(state, [fun](Iterator first, Iterator last) mutable {
                 for (Iterator it = first; it != last; ++it) {
                     fun(*it);
                 }
-            };
+            });
 
             //Distribute evenly the batches
 
             for (std::size_t t = 0; t < thread_pool.size(); ++t) {
-                thread_pool.do_task(batch_functor, first + t * part, first + (t + 1) * part);
+                parallel_detail::submit(thread_pool, t, batch_functor, first + t * part, first + (t + 1) * part);
             }
 
             //Distribute the remainders
 
             if (auto rem = n % thread_pool.size(); rem > 0) {
                 for (Iterator it = last - rem; it < last; ++it) {
-                    thread_pool.do_task(fun, *it);
+                    thread_pool_detail::do_task_or_run(thread_pool, task, *it);
                 }
             }
         }
     } else {
         for (; first != last; ++first) {
-            thread_pool.do_task(fun, *first);
+            thread_pool_detail::do_task_or_run(thread_pool, task, *first);
         }
     }
 
     thread_pool.wait();
+
+    state.rethrow();
 }
 
 /*!
  * \brief Applies the given functor, concurrently, to each value in the given container.
  *
- * All the jobs are submitted to the given thread pool.
+ * All the jobs are submitted to the given thread pool. Lazy views that
+ * cannot be split by their iterators (filtered ranges) are split by
+ * position in their underlying range.
  *
  * \param thread_pool The thread pool responsible for scheduling the jobs.
  * \param container The container to iterate through.
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Container, typename Functor>
-void parallel_foreach(TP& thread_pool, Container& container, Functor fun) {
+void parallel_foreach(TP& thread_pool, Container& container, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     using std::begin;
     using std::end;
-    parallel_foreach(thread_pool, begin(container), end(container), fun);
+
+    if constexpr (!parallel_detail::is_random_access<decltype(begin(container))> && requires { container.slice(0, 0); }) {
+        const std::size_t n = container.base_size();
+
+        if (n) {
+            parallel_detail::for_each_block<Functor>(thread_pool, n, std::min(n, thread_pool.size()), [&container, fun](std::size_t /*b*/, std::size_t first, std::size_t last) {
+                auto slice = container.slice(first, last);
+                cpp::foreach (slice, fun);
+            });
+        }
+    } else {
+        parallel_foreach(thread_pool, begin(container), end(container), fun);
+    }
 }
 
 /*!
@@ -294,46 +661,55 @@ void parallel_foreach(TP& thread_pool, Container& container, Functor fun) {
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Iterator, typename Functor>
-void parallel_foreach_i(TP& thread_pool, Iterator first, Iterator last, Functor fun) {
+void parallel_foreach_i(TP& thread_pool, Iterator first, Iterator last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    parallel_detail::call_state state;
+
+    auto task = parallel_detail::guard<Functor>(state, fun);
+
     if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>) {
         const auto n    = std::distance(first, last);
         const auto part = n / thread_pool.size();
 
         if (part < 2) {
             for (std::size_t i = 0; first != last; ++first, ++i) {
-                thread_pool.do_task(fun, *first, i);
+                thread_pool_detail::do_task_or_run(thread_pool, task, *first, i);
             }
         } else {
-            auto batch_functor = [fun](Iterator first, Iterator last, std::size_t i_start) {
+            auto batch_functor = parallel_detail::guard<Functor>(state, [fun](Iterator first, Iterator last, std::size_t i_start) mutable {
                 std::size_t i = i_start;
                 for (Iterator it = first; it != last; ++it, ++i) {
                     fun(*it, i);
                 }
-            };
+            });
 
             // Distribute evenly the batches
 
             for (std::size_t t = 0; t < thread_pool.size(); ++t) {
-                thread_pool.do_task(batch_functor, first + t * part, first + (t + 1) * part, t * part);
+                parallel_detail::submit(thread_pool, t, batch_functor, first + t * part, first + (t + 1) * part, t * part);
             }
 
             // Compute the remainders
             if (auto rem = n % thread_pool.size(); rem > 0) {
                 std::size_t i = n - rem;
                 for (Iterator it = last - rem; it < last; ++it, ++i) {
-                    fun(*it, i);
+                    task(*it, i);
                 }
             }
         }
     } else {
         for (std::size_t i = 0; first != last; ++first, ++i) {
-            thread_pool.do_task(fun, *first, i);
+            thread_pool_detail::do_task_or_run(thread_pool, task, *first, i);
         }
     }
 
     thread_pool.wait();
+
+    state.rethrow();
 }
 
 /*!
@@ -344,9 +720,12 @@ void parallel_foreach_i(TP& thread_pool, Iterator first, Iterator last, Functor
  * \param thread_pool The thread pool responsible for scheduling the jobs.
  * \param container the container to iterate through
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Container, typename Functor>
-void parallel_foreach_i(TP& thread_pool, Container& container, Functor fun) {
+void parallel_foreach_i(TP& thread_pool, Container& container, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     using std::begin;
     using std::end;
     parallel_foreach_i(thread_pool, begin(container), end(container), fun);
@@ -361,44 +740,53 @@ void parallel_foreach_i(TP& thread_pool, Container& container, Functor fun) {
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Iterator, typename Functor>
-void parallel_foreach_it(TP& thread_pool, Iterator first, Iterator last, Functor fun) {
+void parallel_foreach_it(TP& thread_pool, Iterator first, Iterator last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    parallel_detail::call_state state;
+
+    auto task = parallel_detail::guard<Functor>(state, fun);
+
     if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>) {
         const auto n    = std::distance(first, last);
         const auto part = n / thread_pool.size();
 
         if (part < 2) {
             for (; first != last; ++first) {
-                thread_pool.do_task(fun, first);
+                thread_pool_detail::do_task_or_run(thread_pool, task, first);
             }
         } else {
-            auto batch_functor = [fun](Iterator first, Iterator last) {
+            auto batch_functor = parallel_detail::guard<Functor>(state, [fun](Iterator first, Iterator last) mutable {
                 for (Iterator it = first; it != last; ++it) {
                     fun(it);
                 }
-            };
+            });
 
             // Distribute evenly the batches
 
             for (std::size_t t = 0; t < thread_pool.size(); ++t) {
-                thread_pool.do_task(batch_functor, first + t * part, first + (t + 1) * part);
+                parallel_detail::submit(thread_pool, t, batch_functor, first + t * part, first + (t + 1) * part);
             }
 
             // Compute the remainders
             if (auto rem = n % thread_pool.size(); rem > 0) {
                 for (Iterator it = last - rem; it < last; ++it) {
-                    fun(it);
+                    task(it);
                 }
             }
         }
     } else {
         for (; first != last; ++first) {
-            thread_pool.do_task(fun, first);
+            thread_pool_detail::do_task_or_run(thread_pool, task, first);
         }
     }
 
     thread_pool.wait();
+
+    state.rethrow();
 }
 
 /*!
@@ -409,9 +797,12 @@ void parallel_foreach_it(TP& thread_pool, Iterator first, Iterator last, Functor
  * \param thread_pool The thread pool responsible for scheduling the jobs.
  * \param container The container to iterate through.
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Container, typename Functor>
-void parallel_foreach_it(TP& thread_pool, Container& container, Functor fun) {
+void parallel_foreach_it(TP& thread_pool, Container& container, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     using std::begin;
     using std::end;
 
@@ -427,17 +818,26 @@ void parallel_foreach_it(TP& thread_pool, Container& container, Functor fun) {
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Iterator, typename Functor>
-void parallel_foreach_i_only(TP& thread_pool, Iterator first, Iterator last, Functor fun) {
+void parallel_foreach_i_only(TP& thread_pool, Iterator first, Iterator last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>) {
         parallel_foreach_n(thread_pool, 0, std::distance(first, last), fun);
     } else {
+        parallel_detail::call_state state;
+
+        auto task = parallel_detail::guard<Functor>(state, fun);
+
         for (std::size_t i = 0; first != last; ++first, ++i) {
-            thread_pool.do_task(fun, i);
+            thread_pool_detail::do_task_or_run(thread_pool, task, i);
         }
 
         thread_pool.wait();
+
+        state.rethrow();
     }
 }
 
@@ -449,9 +849,12 @@ void parallel_foreach_i_only(TP& thread_pool, Iterator first, Iterator last, Fun
  * \param thread_pool The thread pool responsible for scheduling the jobs.
  * \param container The container to iterate through.
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Container, typename Functor>
-void parallel_foreach_i_only(TP& thread_pool, Container& container, Functor fun) {
+void parallel_foreach_i_only(TP& thread_pool, Container& container, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     parallel_foreach_n(thread_pool, 0, container.size(), fun);
 }
 
@@ -464,38 +867,47 @@ void parallel_foreach_i_only(TP& thread_pool, Container& container, Functor fun)
  * \param first The beginning of the range
  * \param last The end of the range
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Functor>
-void parallel_foreach_n(TP& thread_pool, std::size_t first, std::size_t last, Functor fun) {
+void parallel_foreach_n(TP& thread_pool, std::size_t first, std::size_t last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     const auto n    = last - first;
     const auto part = n / thread_pool.size();
 
+    parallel_detail::call_state state;
+
+    auto task = parallel_detail::guard<Functor>(state, fun);
+
     if (part < 2) {
         for (std::size_t i = first; i < last; ++i) {
-            thread_pool.do_task(fun, i);
+            thread_pool_detail::do_task_or_run(thread_pool, task, i);
         }
     } else {
-        auto batch_functor = [fun](std::size_t first, std::size_t last) {
+        auto batch_functor = parallel_detail::guard<Functor>(state, [fun](std::size_t first, std::size_t last) mutable {
             for (std::size_t i = first; i < last; ++i) {
                 fun(i);
             }
-        };
+        });
 
         // Distribute evenly the batches
 
         for (std::size_t t = 0; t < thread_pool.size(); ++t) {
-            thread_pool.do_task(batch_functor, t * part, (t + 1) * part);
+            parallel_detail::submit(thread_pool, t, batch_functor, first + t * part, first + (t + 1) * part);
         }
 
         // Compute the remainders
         if (auto rem = n % thread_pool.size(); rem > 0) {
             for (std::size_t i = last - rem; i < last; ++i) {
-                fun(i);
+                task(i);
             }
         }
     }
 
     thread_pool.wait();
+
+    state.rethrow();
 }
 
 /*!
@@ -510,45 +922,1008 @@ void parallel_foreach_n(TP& thread_pool, std::size_t first, std::size_t last, Fu
  * \param s_first The beginning of the second range
  * \param s_last The end of the second range
  * \param fun The functor to apply.
+ * \param location The location of the call, naming the call site of the profiler
  */
 template <typename TP, typename Iterator, typename Iterator2, typename Functor>
-void parallel_foreach_pair_i(TP& thread_pool, Iterator f_first, Iterator f_last, Iterator2 s_first, Iterator2 s_last, Functor fun) {
+void parallel_foreach_pair_i(TP& thread_pool, Iterator f_first, Iterator f_last, Iterator2 s_first, Iterator2 s_last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
     cpp_unused(s_last);
 
+    parallel_detail::call_state state;
+
+    auto task = parallel_detail::guard<Functor>(state, fun);
+
     if constexpr (std::is_same_v<typename std::iterator_traits<Iterator>::iterator_category, std::random_access_iterator_tag>) {
         const std::size_t n    = std::distance(f_first, f_last);
         const std::size_t t    = thread_pool.size();
         const std::size_t part = n / t;
 
-        auto batch_functor = [fun, f_first, s_first](std::size_t first, std::size_t last) {
-            for (std::size_t i = first; i < last; ++i) {
-                fun(*(std::next(f_first, i)), *(std::next(s_first, i)), i);
+        auto batch_functor = parallel_detail::guard<Functor>(state, [fun, f_first, s_first](std::size_t first, std::size_t last) mutable {
+            auto f_it = std::next(f_first, first);
+            auto s_it = std::next(s_first, first);
+
+            for (std::size_t i = first; i < last; ++i, ++f_it, ++s_it) {
+                fun(*f_it, *s_it, i);
             }
-        };
+        });
 
         //Distribute evenly the batches
 
         for (std::size_t i = 0; i < t; ++i) {
-            thread_pool.do_task(batch_functor, i * part, (i + 1) * part);
+            parallel_detail::submit(thread_pool, i, batch_functor, i * part, (i + 1) * part);
         }
 
         // Compute the remainders
         if (auto rem = n % t; rem > 0) {
-            for (std::size_t i = n - rem; i < n; ++i) {
-                fun(*(std::next(f_first, i)), *(std::next(s_first, i)), i);
-            }
+            batch_functor(n - rem, n);
         }
     } else {
         for (std::size_t i = 0; f_first != f_last; ++f_first, ++s_first, ++i) {
-            thread_pool.do_task(fun, *f_first, *s_first, i);
+            thread_pool_detail::do_task_or_run(thread_pool, task, *f_first, *s_first, i);
         }
     }
 
     thread_pool.wait();
+
+    state.rethrow();
 }
 
-} //end of the cpp namespace
+////////////////////////////
+//3. Thread pool algorithms//
+////////////////////////////
 
-#include "thread_pool.hpp"
+namespace parallel_detail {
+
+/*!
+ * \brief Evaluate pred on each index of [0, n) concurrently and store the
+ * results into a bitset.
+ *
+ * The blocks are aligned on the words of the bitset so that the blocks
+ * never write to the same word.
+ *
+ * \tparam UserFunctor The type of the functor of the user (see for_each_block())
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param n The number of elements
+ * \param pred The predicate, called with the index of each element
+ * \param flags The bitset receiving the results of the predicate
+ * \param counts The number of elements satisfying pred, for each block
+ */
+template <typename UserFunctor, typename TP, typename Predicate>
+void evaluate_flags_n(TP& thread_pool, std::size_t n, Predicate&& pred, dense_bitset& flags, std::vector<std::size_t>& counts) {
+    const std::size_t nw = flags.num_words();
+
+    for_each_block<UserFunctor>(thread_pool, nw, counts.size(), [n, &pred, &flags, &counts](std::size_t b, std::size_t w_first, std::size_t w_last) {
+        auto* words       = flags.words();
+        std::size_t count = 0;
+
+        for (std::size_t w = w_first; w < w_last; ++w) {
+            const std::size_t i_first = w * 64;
+            const std::size_t i_last  = std::min(n, i_first + 64);
+
+            dense_bitset::word_t word = 0;
+
+            for (std::size_t i = i_first; i < i_last; ++i) {
+                word |= dense_bitset::word_t(bool(pred(i))) << (i - i_first);
+            }
+
+            words[w] = word;
+            count += std::popcount(word);
+        }
+
+        counts[b] = count;
+    });
+}
+
+/*!
+ * \brief Evaluate pred on each element of [first, last) concurrently and
+ * store the results into a bitset.
+ *
+ * \tparam UserFunctor The type of the functor of the user (see for_each_block())
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param flags The bitset receiving the results of the predicate
+ * \param counts The number of elements satisfying pred, for each block
+ */
+template <typename UserFunctor, typename TP, typename Iterator, typename Predicate>
+void evaluate_flags(TP& thread_pool, Iterator first, Iterator last, Predicate& pred, dense_bitset& flags, std::vector<std::size_t>& counts) {
+    evaluate_flags_n<UserFunctor>(thread_pool, std::distance(first, last), [first, &pred](std::size_t i) { return pred(first[i]); }, flags, counts);
+}
+
+/*!
+ * \brief Returns the number of blocks to use to compact n elements
+ */
+template <typename TP>
+std::size_t compaction_blocks(TP& thread_pool, std::size_t n) {
+    return std::max(std::size_t(1), std::min(thread_pool.size(), bitset_detail::words_for(n)));
+}
+
+/*!
+ * \brief Replace the counts by their exclusive prefix sum
+ * \return the total sum of the counts
+ */
+inline std::size_t exclusive_scan(std::vector<std::size_t>& counts) {
+    std::size_t total = 0;
+
+    for (auto& count : counts) {
+        auto c = count;
+        count  = total;
+        total += c;
+    }
+
+    return total;
+}
+
+/*!
+ * \brief The deleter of a temporary buffer filled by blocks.
+ *
+ * The elements still constructed by each block are destroyed before the
+ * buffer is deallocated, which releases the buffer correctly when a block
+ * fails.
+ */
+template <typename T>
+struct block_buffer_deleter {
+    std::size_t capacity;                    ///< The number of elements of the buffer
+    const std::vector<std::size_t>& offsets; ///< The offset of each block in the buffer
+    std::vector<std::size_t> constructed;    ///< The number of elements constructed at the offset of each block
+
+    /*!
+     * \brief Destroy the constructed elements and deallocate the buffer
+     */
+    void operator()(T* buffer) {
+        for (std::size_t b = 0; b < offsets.size(); ++b) {
+            std::destroy_n(buffer + offsets[b], constructed[b]);
+        }
+
+        std::allocator<T>().deallocate(buffer, capacity);
+    }
+};
+
+/*!
+ * \brief Keep, in order, the flagged elements of [first, last) at the
+ * beginning of the range.
+ *
+ * The kept elements are first moved into a temporary buffer and then
+ * moved back into the range. If moving an element throws, the elements
+ * of the buffer are destroyed and the range is left in a valid but
+ * unspecified state.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param flags The flags of the elements to keep
+ * \param offsets The exclusive scan of the number of flags of each block
+ * \param total The number of elements to keep
+ * \return The new end of the range
+ */
+template <typename TP, typename Iterator>
+Iterator keep_flagged(TP& thread_pool, Iterator first, Iterator last, const dense_bitset& flags, const std::vector<std::size_t>& offsets, std::size_t total) {
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    if (total == std::size_t(std::distance(first, last))) {
+        return last;
+    }
+
+    const std::size_t capacity = std::max(total, std::size_t(1));
+
+    std::unique_ptr<value_type, block_buffer_deleter<value_type>> storage(
+        std::allocator<value_type>().allocate(capacity), {capacity, offsets, std::vector<std::size_t>(offsets.size())});
+
+    auto* buffer      = storage.get();
+    auto& constructed = storage.get_deleter().constructed;
+
+    for_each_block(thread_pool, flags.num_words(), offsets.size(), [first, buffer, &flags, &offsets, &constructed](std::size_t b, std::size_t w_first, std::size_t w_last) {
+        const auto* words = flags.words();
+        auto* start       = buffer + offsets[b];
+        auto* o           = start;
+
+        auto move_out = [&]() {
+            for (std::size_t w = w_first; w < w_last; ++w) {
+                for (auto word = words[w]; word; word &= word - 1) {
+                    std::construct_at(o, std::move(first[w * 64 + std::countr_zero(word)]));
+                    ++o;
+                }
+            }
+        };
+
+#ifndef CPP_UTILS_NO_EXCEPT
+        try {
+            move_out();
+        } catch (...) {
+            // Only the elements constructed so far are destroyed with the buffer
+            constructed[b] = o - start;
+            throw;
+        }
+#else
+        move_out();
+#endif
+
+        constructed[b] = o - start;
+    });
+
+    // Each block moves back the elements it has moved out
+    for_each_block(thread_pool, offsets.size(), offsets.size(), [first, buffer, &offsets, &constructed](std::size_t b, std::size_t /*first*/, std::size_t /*last*/) {
+        auto* start = buffer + offsets[b];
+
+        std::move(start, start + constructed[b], first + offsets[b]);
+        std::destroy_n(start, constructed[b]);
+        constructed[b] = 0;
+    });
+
+    return first + total;
+}
+
+} //end of namespace parallel_detail
+
+/*!
+ * \brief Copy, concurrently, the elements of [first, last) for which pred returns true into the range beginning at out.
+ *
+ * The relative order of the elements is preserved. The predicate is
+ * evaluated exactly once per element, concurrently. The algorithm does a
+ * parallel pass to evaluate the predicate and count the elements of each
+ * block, a scan of the counts and a parallel scatter pass.
+ *
+ * When the input or the output is not random access, the serial
+ * std::copy_if is used.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out The beginning of the output range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The end of the output range
+ */
+template <typename TP, typename Iterator, typename OutputIterator, typename Predicate>
+OutputIterator parallel_copy_if(TP& thread_pool, Iterator first, Iterator last, OutputIterator out, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && parallel_detail::is_random_access<OutputIterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        dense_bitset flags(n);
+        std::vector<std::size_t> offsets(parallel_detail::compaction_blocks(thread_pool, n));
+
+        parallel_detail::evaluate_flags<Predicate>(thread_pool, first, last, pred, flags, offsets);
+
+        const auto total = parallel_detail::exclusive_scan(offsets);
+
+        parallel_detail::for_each_block(thread_pool, flags.num_words(), offsets.size(), [first, out, &flags, &offsets](std::size_t b, std::size_t w_first, std::size_t w_last) {
+            const auto* words = flags.words();
+            auto o            = out + offsets[b];
+
+            for (std::size_t w = w_first; w < w_last; ++w) {
+                for (auto word = words[w]; word; word &= word - 1) {
+                    *o++ = first[w * 64 + std::countr_zero(word)];
+                }
+            }
+        });
+
+        return out + total;
+    } else {
+        return std::copy_if(first, last, out, pred);
+    }
+}
+
+/*!
+ * \brief Copy, concurrently, the elements of the container for which pred returns true into the range beginning at out.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to filter
+ * \param out The beginning of the output range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The end of the output range
+ */
+template <typename TP, typename Container, typename OutputIterator, typename Predicate>
+OutputIterator parallel_copy_if(TP& thread_pool, const Container& container, OutputIterator out, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_copy_if(thread_pool, begin(container), end(container), out, pred);
+}
+
+/*!
+ * \brief Copy, concurrently, the elements of [first, last) into two
+ * ranges, depending on the result of pred.
+ *
+ * The relative order of the elements is preserved in both ranges. When the
+ * input or the outputs are not random access, the serial
+ * std::partition_copy is used.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param out_true The beginning of the output range for the elements satisfying pred
+ * \param out_false The beginning of the output range for the other elements
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The ends of the two output ranges
+ */
+template <typename TP, typename Iterator, typename OutputIterator1, typename OutputIterator2, typename Predicate>
+std::pair<OutputIterator1, OutputIterator2> parallel_partition_copy(TP& thread_pool, Iterator first, Iterator last, OutputIterator1 out_true, OutputIterator2 out_false, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && parallel_detail::is_random_access<OutputIterator1> && parallel_detail::is_random_access<OutputIterator2>) {
+        const std::size_t n = std::distance(first, last);
+
+        dense_bitset flags(n);
+        std::vector<std::size_t> true_offsets(parallel_detail::compaction_blocks(thread_pool, n));
+
+        parallel_detail::evaluate_flags<Predicate>(thread_pool, first, last, pred, flags, true_offsets);
+
+        // The false elements of each block are the remaining elements
+        std::vector<std::size_t> false_offsets(true_offsets.size());
+        for (std::size_t b = 0; b < true_offsets.size(); ++b) {
+            const auto w_first = flags.num_words() * b / true_offsets.size();
+            const auto w_last  = flags.num_words() * (b + 1) / true_offsets.size();
+            false_offsets[b]   = std::min(n, w_last * 64) - std::min(n, w_first * 64) - true_offsets[b];
+        }
+
+        const auto total_true  = parallel_detail::exclusive_scan(true_offsets);
+        const auto total_false = parallel_detail::exclusive_scan(false_offsets);
+
+        parallel_detail::for_each_block(thread_pool, flags.num_words(), true_offsets.size(), [=, &flags, &true_offsets, &false_offsets](std::size_t b, std::size_t w_first, std::size_t w_last) {
+            const auto* words = flags.words();
+            auto t            = out_true + true_offsets[b];
+            auto f            = out_false + false_offsets[b];
+
+            for (std::size_t w = w_first; w < w_last; ++w) {
+                const std::size_t i_first = w * 64;
+                const std::size_t i_last  = std::min(n, i_first + 64);
+
+                auto it = first + i_first;
+                for (std::size_t i = i_first; i < i_last; ++i, ++it) {
+                    if (words[w] & (dense_bitset::word_t(1) << (i - i_first))) {
+                        *t++ = *it;
+                    } else {
+                        *f++ = *it;
+                    }
+                }
+            }
+        });
+
+        return {out_true + total_true, out_false + total_false};
+    } else {
+        return std::partition_copy(first, last, out_true, out_false, pred);
+    }
+}
+
+/*!
+ * \brief Remove, concurrently, the elements of [first, last) for which pred returns true.
+ *
+ * The relative order of the remaining elements is preserved. The remaining
+ * elements are first moved into a temporary buffer and then moved back
+ * into the range. When the range is not random access or is made of
+ * packed bits (std::vector<bool>), the serial std::remove_if is used.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The new end of the range
+ */
+template <typename TP, typename Iterator, typename Predicate>
+Iterator parallel_remove_if(TP& thread_pool, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && !parallel_detail::is_packed_bool<Iterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        dense_bitset flags(n);
+        std::vector<std::size_t> offsets(parallel_detail::compaction_blocks(thread_pool, n));
+
+        auto keep = [&pred](auto&& value) { return !pred(value); };
+        parallel_detail::evaluate_flags<Predicate>(thread_pool, first, last, keep, flags, offsets);
+
+        const auto total = parallel_detail::exclusive_scan(offsets);
+
+        return parallel_detail::keep_flagged(thread_pool, first, last, flags, offsets, total);
+    } else {
+        return std::remove_if(first, last, pred);
+    }
+}
+
+/*!
+ * \brief Remove, concurrently, the consecutive duplicates of [first, last).
+ *
+ * The first element of each group of consecutive equal elements is kept
+ * and the relative order of the kept elements is preserved. The elements
+ * to keep are flagged concurrently, before any element is moved. When the
+ * range is not random access or is made of packed bits
+ * (std::vector<bool>), the serial std::unique is used.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param eq The binary equality predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The new end of the range
+ */
+template <typename TP, typename Iterator, typename BinaryPredicate>
+Iterator parallel_unique(TP& thread_pool, Iterator first, Iterator last, BinaryPredicate eq, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && !parallel_detail::is_packed_bool<Iterator>) {
+        const std::size_t n = std::distance(first, last);
+
+        dense_bitset flags(n);
+        std::vector<std::size_t> offsets(parallel_detail::compaction_blocks(thread_pool, n));
+
+        parallel_detail::evaluate_flags_n<BinaryPredicate>(thread_pool, n, [first, &eq](std::size_t i) { return i == 0 || !eq(first[i - 1], first[i]); }, flags, offsets);
+
+        const auto total = parallel_detail::exclusive_scan(offsets);
+
+        return parallel_detail::keep_flagged(thread_pool, first, last, flags, offsets, total);
+    } else {
+        return std::unique(first, last, eq);
+    }
+}
+
+/*!
+ * \brief Remove, concurrently, the consecutive duplicates of [first, last).
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The new end of the range
+ */
+template <typename TP, typename Iterator>
+Iterator parallel_unique(TP& thread_pool, Iterator first, Iterator last, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_unique(thread_pool, first, last, std::equal_to<>());
+}
+
+/*!
+ * \brief Transform, concurrently, a range and store the result into a vector
+ *
+ * The vector is allocated once and each task assigns a disjoint slice of
+ * it. The elements are value-initialized first: a std::vector cannot take
+ * ownership of storage constructed concurrently. When the range is not
+ * random access, when the transformed values cannot be default
+ * constructed or when they are bool (std::vector<bool> packs them in
+ * shared words), the serial vector_transform is used.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param fun The transform functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return A vector filled with the transformed objects
+ */
+template <typename TP, typename Iterator, typename Functor>
+auto parallel_vector_transform(TP& thread_pool, Iterator first, Iterator last, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using value_type = algorithm_detail::transform_value_t<Iterator, Functor>;
+
+    if constexpr (parallel_detail::is_random_access<Iterator> && std::is_default_constructible_v<value_type> && !std::is_same_v<value_type, bool>) {
+        const std::size_t n = std::distance(first, last);
+
+        std::vector<value_type> transformed(n);
+
+        if (n) {
+            parallel_detail::for_each_block<Functor>(thread_pool, n, std::min(n, thread_pool.size()), [first, fun, out = transformed.data()](std::size_t /*b*/, std::size_t i_first, std::size_t i_last) mutable {
+                auto it = first + i_first;
+                for (std::size_t i = i_first; i < i_last; ++i, ++it) {
+                    out[i] = fun(*it);
+                }
+            });
+        }
+
+        return transformed;
+    } else {
+        cpp_unused(thread_pool);
+        return vector_transform(first, last, fun);
+    }
+}
+
+/*!
+ * \brief Transform, concurrently, a container and store the result into a vector
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to transform
+ * \param fun The transform functor
+ * \param location The location of the call, naming the call site of the profiler
+ * \return A vector filled with the transformed objects
+ */
+template <typename TP, typename Container, typename Functor>
+auto parallel_vector_transform(TP& thread_pool, const Container& container, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_vector_transform(thread_pool, begin(container), end(container), fun);
+}
+
+namespace parallel_detail {
+
+/*!
+ * \brief Returns a raw pointer for contiguous iterators, the iterator itself otherwise.
+ *
+ * This lets the inner loops of the parallel algorithms increment plain
+ * pointers, which the compiler optimizes (and vectorizes) better.
+ */
+template <typename Iterator>
+auto raw_iterator(Iterator it) {
+    if constexpr (std::contiguous_iterator<Iterator>) {
+        return std::to_address(it);
+    } else {
+        return it;
+    }
+}
+
+/*!
+ * \brief Returns the size of the shortest of the given ranges
+ */
+template <typename... Ranges>
+std::size_t zip_size(Ranges&... ranges) {
+    using std::begin;
+    using std::end;
+    return std::min({static_cast<std::size_t>(std::distance(begin(ranges), end(ranges)))...});
+}
+
+} //end of namespace parallel_detail
+
+/*!
+ * \brief Applies the given functor, concurrently, to chunks of the elements at the same position in all the given ranges.
+ *
+ * The [0, n) positions, with n the size of the shortest range, are split
+ * into one chunk per thread. For each chunk [first, last), the functor is
+ * called once with first, last and an iterator at position first in each
+ * range (a raw pointer for contiguous ranges).
+ *
+ * When one of the ranges is not random access, the functor is called once,
+ * on the calling thread, with the whole ranges.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param fun The functor to apply to each chunk
+ * \param ranges The ranges to iterate
+ */
+template <typename TP, typename Functor, typename... Ranges>
+void parallel_foreach_zip_chunk(TP& thread_pool, Functor fun, Ranges&&... ranges) {
+    using std::begin;
+
+    const std::size_t n = parallel_detail::zip_size(ranges...);
+
+    if constexpr ((... && parallel_detail::is_random_access<decltype(begin(ranges))>)) {
+        if (!n) {
+            return;
+        }
+
+        auto firsts = std::make_tuple(begin(ranges)...);
+
+        parallel_detail::for_each_block<Functor>(thread_pool, n, std::min(n, thread_pool.size()), [fun, firsts](std::size_t /*b*/, std::size_t first, std::size_t last) {
+            std::apply([&](auto... its) {
+                fun(first, last, parallel_detail::raw_iterator(its + first)...);
+            }, firsts);
+        });
+    } else {
+        cpp_unused(thread_pool);
+        fun(std::size_t(0), n, begin(ranges)...);
+    }
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to the elements at the same position in all the given ranges.
+ *
+ * This generalizes parallel_foreach_pair_i to any number of ranges. The
+ * positions are split into one chunk per thread and each chunk increments
+ * one iterator (or pointer, for contiguous ranges) per range. The
+ * iteration stops at the end of the shortest range. When one of the ranges
+ * is not random access, the ranges are iterated serially.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param fun The functor to apply, called with one element of each range
+ * \param ranges The ranges to iterate
+ */
+template <typename TP, typename Functor, typename... Ranges>
+void parallel_foreach_zip(TP& thread_pool, Functor fun, Ranges&&... ranges) {
+    parallel_foreach_zip_chunk(thread_pool, [fun](std::size_t first, std::size_t last, auto... its) {
+        for (std::size_t i = first; i < last; ++i) {
+            fun(*its...);
+            (++its, ...);
+        }
+    }, ranges...);
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to each index in the range [first, last), with a per-block state.
+ *
+ * The range is split into one block per thread. Each block creates its
+ * state once, with init(), and reuses it for all its indices, with
+ * fun(state, i). Once all the blocks are done, finalize(state) is called
+ * on the calling thread for each state, in the order of the blocks. This
+ * allows scratch buffers to be allocated once per block and partial
+ * results to be merged without locks.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The functor creating a state
+ * \param fun The functor to apply, called with the state and the index
+ * \param finalize The functor to call with each state once done
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Init, typename Functor, typename Finalize>
+void parallel_foreach_n_with_state(TP& thread_pool, std::size_t first, std::size_t last, Init init, Functor fun, Finalize finalize, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using state_t = std::decay_t<std::invoke_result_t<Init&>>;
+
+    const std::size_t n = last - first;
+
+    if (!n) {
+        return;
+    }
+
+    std::vector<std::optional<state_t>> states(std::min(n, thread_pool.size()));
+
+    // Not guarded only when both init and fun are nothrow_functor
+    using user_functor = std::conditional_t<parallel_detail::is_nothrow_functor<Init>, Functor, Init>;
+
+    parallel_detail::for_each_block<user_functor>(thread_pool, n, states.size(), [first, init, fun, &states](std::size_t b, std::size_t i_first, std::size_t i_last) mutable {
+        auto& state = states[b].emplace(init());
+
+        for (std::size_t i = first + i_first; i < first + i_last; ++i) {
+            fun(state, i);
+        }
+    });
+
+    for (auto& state : states) {
+        finalize(*state);
+    }
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to each index in the range [first, last), with a per-block state.
+ *
+ * The states are simply destroyed once all the blocks are done.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The functor creating a state
+ * \param fun The functor to apply, called with the state and the index
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Init, typename Functor>
+void parallel_foreach_n_with_state(TP& thread_pool, std::size_t first, std::size_t last, Init init, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    parallel_foreach_n_with_state(thread_pool, first, last, init, fun, [](auto& /*state*/) {});
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to each element in the range [first, last), with a per-block state.
+ *
+ * Each block creates its state once, with init(), and reuses it for all
+ * its elements, with fun(state, element). Once all the blocks are done,
+ * finalize(state) is called on the calling thread for each state, in the
+ * order of the blocks. When the range is not random access, the elements
+ * are processed serially with a single state.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The functor creating a state
+ * \param fun The functor to apply, called with the state and the element
+ * \param finalize The functor to call with each state once done
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Iterator, typename Init, typename Functor, typename Finalize>
+void parallel_foreach_with_state(TP& thread_pool, Iterator first, Iterator last, Init init, Functor fun, Finalize finalize, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        parallel_foreach_n_with_state(thread_pool, 0, std::distance(first, last), init, [first, fun](auto& state, std::size_t i) mutable {
+            fun(state, first[i]);
+        }, finalize);
+    } else {
+        cpp_unused(thread_pool);
+
+        if (first != last) {
+            auto state = init();
+
+            for (; first != last; ++first) {
+                fun(state, *first);
+            }
+
+            finalize(state);
+        }
+    }
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to each element in the range [first, last), with a per-block state.
+ *
+ * The states are simply destroyed once all the blocks are done.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param init The functor creating a state
+ * \param fun The functor to apply, called with the state and the element
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Iterator, typename Init, typename Functor>
+void parallel_foreach_with_state(TP& thread_pool, Iterator first, Iterator last, Init init, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    parallel_foreach_with_state(thread_pool, first, last, init, fun, [](auto& /*state*/) {});
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to each element of the container, with a per-block state.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to iterate
+ * \param init The functor creating a state
+ * \param fun The functor to apply, called with the state and the element
+ * \param finalize The functor to call with each state once done
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Container, typename Init, typename Functor, typename Finalize>
+void parallel_foreach_with_state(TP& thread_pool, Container& container, Init init, Functor fun, Finalize finalize, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    parallel_foreach_with_state(thread_pool, begin(container), end(container), init, fun, finalize);
+}
+
+/*!
+ * \brief Applies the given functor, concurrently, to each element of the container, with a per-block state.
+ *
+ * The states are simply destroyed once all the blocks are done.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to iterate
+ * \param init The functor creating a state
+ * \param fun The functor to apply, called with the state and the element
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Container, typename Init, typename Functor>
+void parallel_foreach_with_state(TP& thread_pool, Container& container, Init init, Functor fun, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    parallel_foreach_with_state(thread_pool, container, init, fun, [](auto& /*state*/) {});
+}
+
+namespace parallel_detail {
+
+/*!
+ * \brief Search, concurrently, for an element satisfying the predicate.
+ *
+ * The range is split into small chunks, claimed in increasing order from
+ * a shared counter by one task per thread. The tasks stop claiming chunks
+ * as soon as a match makes the remaining chunks useless. When Lowest is
+ * true, the lowest matching index is returned, deterministically, since
+ * only the chunks after a match are skipped. Otherwise, any matching
+ * index is returned and all the tasks stop at the first match.
+ *
+ * \return The index of the matching element, or n if there is none
+ */
+template <bool Lowest, typename TP, typename Iterator, typename Predicate>
+std::size_t search(TP& thread_pool, Iterator first, std::size_t n, Predicate& pred) {
+    constexpr std::size_t chunks_per_thread = 16; // Small chunks let the tasks stop early
+
+    if (!n) {
+        return n;
+    }
+
+    const std::size_t threads = std::min(n, thread_pool.size());
+    const std::size_t chunk   = std::max(std::size_t(1), n / (threads * chunks_per_thread));
+
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> best{n};
+
+    for_each_block<Predicate>(thread_pool, threads, threads, [first, n, chunk, &pred, &next, &best](std::size_t /*b*/, std::size_t /*first*/, std::size_t /*last*/) {
+        while (true) {
+            const std::size_t c_first = next.fetch_add(1, std::memory_order_relaxed) * chunk;
+            const std::size_t current = best.load(std::memory_order_relaxed);
+
+            if (c_first >= n || (Lowest ? c_first >= current : current != n)) {
+                return;
+            }
+
+            const std::size_t c_last = std::min(c_first + chunk, n);
+
+            auto it = first + c_first;
+            for (std::size_t i = c_first; i < c_last; ++i, ++it) {
+                if (pred(*it)) {
+                    // The next chunks of this task are all after this match
+                    std::size_t expected = best.load(std::memory_order_relaxed);
+                    while (i < expected && !best.compare_exchange_weak(expected, i, std::memory_order_relaxed)) {}
+                    return;
+                }
+            }
+        }
+    });
+
+    return best.load();
+}
+
+} //end of namespace parallel_detail
+
+/*!
+ * \brief Find, concurrently, the first element of the range satisfying the predicate.
+ *
+ * The search stops as soon as the first match is known. When the range is
+ * not random access, the search is serial.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator to the first matching element, last if there is none
+ */
+template <typename TP, typename Iterator, typename Predicate>
+Iterator parallel_find_if(TP& thread_pool, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        return first + parallel_detail::search<true>(thread_pool, first, std::distance(first, last), pred);
+    } else {
+        cpp_unused(thread_pool);
+        return std::find_if(first, last, pred);
+    }
+}
+
+/*!
+ * \brief Find, concurrently, the first element of the container satisfying the predicate.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to search
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator to the first matching element, end(container) if there is none
+ */
+template <typename TP, typename Container, typename Predicate>
+auto parallel_find_if(TP& thread_pool, Container& container, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_find_if(thread_pool, begin(container), end(container), pred);
+}
+
+/*!
+ * \brief Find, concurrently, the first element of the range equal to value.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param value The value to search for
+ * \param location The location of the call, naming the call site of the profiler
+ * \return An iterator to the first equal element, last if there is none
+ */
+template <typename TP, typename Iterator, typename T>
+Iterator parallel_find(TP& thread_pool, Iterator first, Iterator last, const T& value, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return parallel_find_if(thread_pool, first, last, [&value](const auto& element) { return element == value; });
+}
+
+/*!
+ * \brief Test, concurrently, if any element of the range satisfies the predicate.
+ *
+ * All the tasks stop as soon as one match is found.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns true for at least one element, false otherwise
+ */
+template <typename TP, typename Iterator, typename Predicate>
+bool parallel_any_of(TP& thread_pool, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    if constexpr (parallel_detail::is_random_access<Iterator>) {
+        const std::size_t n = std::distance(first, last);
+        return parallel_detail::search<false>(thread_pool, first, n, pred) != n;
+    } else {
+        cpp_unused(thread_pool);
+        return std::any_of(first, last, pred);
+    }
+}
+
+/*!
+ * \brief Test, concurrently, if any element of the container satisfies the predicate.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to test
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns true for at least one element, false otherwise
+ */
+template <typename TP, typename Container, typename Predicate>
+bool parallel_any_of(TP& thread_pool, Container& container, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_any_of(thread_pool, begin(container), end(container), pred);
+}
+
+/*!
+ * \brief Test, concurrently, if all the elements of the range satisfy the predicate.
+ *
+ * All the tasks stop as soon as one element fails the predicate.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns true for all the elements, false otherwise
+ */
+template <typename TP, typename Iterator, typename Predicate>
+bool parallel_all_of(TP& thread_pool, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    auto negated = [&pred](const auto& element) { return !pred(element); };
+
+    if constexpr (parallel_detail::is_nothrow_functor<Predicate>) {
+        return !parallel_any_of(thread_pool, first, last, assume_nothrow(negated));
+    } else {
+        return !parallel_any_of(thread_pool, first, last, negated);
+    }
+}
+
+/*!
+ * \brief Test, concurrently, if all the elements of the container satisfy the predicate.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to test
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns true for all the elements, false otherwise
+ */
+template <typename TP, typename Container, typename Predicate>
+bool parallel_all_of(TP& thread_pool, Container& container, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_all_of(thread_pool, begin(container), end(container), pred);
+}
+
+/*!
+ * \brief Test, concurrently, if no element of the range satisfies the predicate.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns false for all the elements, false otherwise
+ */
+template <typename TP, typename Iterator, typename Predicate>
+bool parallel_none_of(TP& thread_pool, Iterator first, Iterator last, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    return !parallel_any_of(thread_pool, first, last, pred);
+}
+
+/*!
+ * \brief Test, concurrently, if no element of the container satisfies the predicate.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container to test
+ * \param pred The predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return true if pred returns false for all the elements, false otherwise
+ */
+template <typename TP, typename Container, typename Predicate>
+bool parallel_none_of(TP& thread_pool, Container& container, Predicate pred, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_none_of(thread_pool, begin(container), end(container), pred);
+}
+
+} //end of the cpp namespace
 
 #endif //CPP_UTILS_PARALLEL_HPP
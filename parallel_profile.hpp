@@ -0,0 +1,328 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file parallel_profile.hpp
+ * \brief Contains the profiler of the parallel loops.
+ *
+ * When CPP_UTILS_PARALLEL_PROFILE is defined, each call of a thread pool
+ * algorithm of parallel.hpp records the duration of each of its chunks.
+ * The calls are aggregated per call site: the name of the enclosing
+ * parallel_profile_scope or, by default, the file:line of the call of the
+ * algorithm, taken from its call_site parameter. The algorithms without
+ * call_site parameter (the variadic ones) are named after the function
+ * submitting the chunks.
+ *
+ * \code
+ * {
+ *     cpp::parallel_profile_scope scope("update");
+ *     cpp::parallel_foreach_n(pool, 0, n, update);
+ * }
+ *
+ * cpp::parallel_profile_report(std::cout);
+ * \endcode
+ *
+ * Without CPP_UTILS_PARALLEL_PROFILE, nothing is recorded and the
+ * algorithms are not slowed down.
+ */
+
+#ifndef CPP_UTILS_PARALLEL_PROFILE_HPP
+#define CPP_UTILS_PARALLEL_PROFILE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "stop_watch.hpp"
+
+namespace cpp {
+
+/*!
+ * \brief The profile of one call site of the parallel algorithms.
+ *
+ * The durations are in nanoseconds and summed over all the calls. The
+ * busy time of a worker is the sum of the durations of its chunks. The
+ * critical path of a call is the busy time of its busiest worker, the
+ * dispatch overhead is the part of the call not covered by the critical
+ * path (submission, wake up of the workers and waiting).
+ */
+struct parallel_site_profile {
+    std::string name;                ///< The name of the call site
+    std::size_t calls       = 0;     ///< The number of calls
+    std::size_t chunks      = 0;     ///< The number of chunks
+    std::size_t workers     = 0;     ///< The number of threads that executed chunks
+    double wall_ns          = 0.0;   ///< The duration of the calls
+    double busy_ns          = 0.0;   ///< The busy time of all the workers
+    double critical_ns      = 0.0;   ///< The critical paths of the calls
+    double mean_ns          = 0.0;   ///< The mean busy times per worker of the calls
+    double dispatch_ns      = 0.0;   ///< The dispatch overheads of the calls
+    double chunk_min_ns     = 0.0;   ///< The duration of the shortest chunk
+    double chunk_max_ns     = 0.0;   ///< The duration of the longest chunk
+    std::vector<double> last_chunks; ///< The durations of the chunks of the last call
+    std::vector<double> last_busy;   ///< The busy times of the workers of the last call
+
+    /*!
+     * \brief Returns the load imbalance, the critical path divided by the mean busy time (1.0 is perfect)
+     */
+    double imbalance() const {
+        return mean_ns > 0.0 ? critical_ns / mean_ns : 1.0;
+    }
+};
+
+namespace parallel_profile_detail {
+
+/*!
+ * \brief The name of the innermost parallel_profile_scope of the current thread
+ */
+inline thread_local const char* current_scope = nullptr;
+
+/*!
+ * \brief The location of the outermost parallel algorithm called by the
+ * current thread, outside of the chunks of another algorithm.
+ */
+inline thread_local const std::source_location* current_site = nullptr;
+
+/*!
+ * \brief The profiles of all the call sites
+ */
+struct registry {
+    std::mutex lock;                                   ///< The lock protecting the sites
+    std::map<std::string, parallel_site_profile> sites; ///< The profile of each call site
+
+    /*!
+     * \brief Returns the registry of the process
+     */
+    static registry& get() {
+        static registry instance;
+        return instance;
+    }
+};
+
+/*!
+ * \brief Returns the short name (without namespaces, templates and
+ * parameters) of the function of the given location.
+ */
+inline std::string function_name(const std::source_location& location) {
+    std::string_view name = location.function_name();
+
+    name = name.substr(0, name.find('('));
+
+    if (auto space = name.rfind(' '); space != std::string_view::npos) {
+        name = name.substr(space + 1);
+    }
+
+    if (auto colons = name.rfind("::"); colons != std::string_view::npos) {
+        name = name.substr(colons + 2);
+    }
+
+    return std::string(name);
+}
+
+/*!
+ * \brief Returns the name of the call site of the current thread, or the
+ * short name of the function of the given location if there is none.
+ */
+inline std::string site_name(const std::source_location& location) {
+    if (current_scope) {
+        return current_scope;
+    }
+
+    if (current_site) {
+        return std::string(current_site->file_name()) + ":" + std::to_string(current_site->line());
+    }
+
+    return function_name(location);
+}
+
+/*!
+ * \brief The profile of one call of a parallel algorithm, added to the
+ * profile of its call site when destructed.
+ */
+struct call {
+    /*!
+     * \brief Start the profile of a call of the algorithm at the given location
+     */
+    explicit call(const std::source_location& location)
+            : name(site_name(location)), start(clock_type::now()) {
+        //Nothing else to init
+    }
+
+    call(const call& rhs) = delete;
+    call& operator=(const call& rhs) = delete;
+
+    /*!
+     * \brief Execute the given chunk and record its duration.
+     *
+     * The algorithms called by the chunk are profiled at their own call
+     * sites.
+     */
+    template <typename Functor>
+    void time(Functor&& fun) {
+        const auto* saved_site = std::exchange(current_site, nullptr);
+
+        const auto chunk_start = clock_type::now();
+        fun();
+        const double ns = std::chrono::duration<double, std::nano>(clock_type::now() - chunk_start).count();
+
+        current_site = saved_site;
+
+        const auto id = std::this_thread::get_id();
+
+        std::unique_lock<std::mutex> l(lock);
+
+        chunks.push_back(ns);
+
+        auto it = std::find_if(busy.begin(), busy.end(), [id](auto& worker) { return worker.first == id; });
+
+        if (it == busy.end()) {
+            busy.emplace_back(id, ns);
+        } else {
+            it->second += ns;
+        }
+    }
+
+    /*!
+     * \brief Add the call to the profile of its call site
+     */
+    ~call() {
+        const double wall = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+
+        double critical = 0.0;
+        double total    = 0.0;
+        std::vector<double> last_busy;
+
+        for (auto& worker : busy) {
+            critical = std::max(critical, worker.second);
+            total += worker.second;
+            last_busy.push_back(worker.second);
+        }
+
+        auto& r = registry::get();
+
+        std::unique_lock<std::mutex> l(r.lock);
+
+        auto& site = r.sites[name];
+
+        if (!chunks.empty()) {
+            const auto [min, max] = std::minmax_element(chunks.begin(), chunks.end());
+
+            site.chunk_min_ns = site.chunks ? std::min(site.chunk_min_ns, *min) : *min;
+            site.chunk_max_ns = std::max(site.chunk_max_ns, *max);
+        }
+
+        site.name = name;
+        ++site.calls;
+        site.chunks += chunks.size();
+        site.workers += busy.size();
+        site.wall_ns += wall;
+        site.busy_ns += total;
+        site.critical_ns += critical;
+        site.mean_ns += busy.empty() ? 0.0 : total / busy.size();
+        site.dispatch_ns += std::max(0.0, wall - critical);
+        site.last_chunks = std::move(chunks);
+        site.last_busy   = std::move(last_busy);
+    }
+
+private:
+    const std::string name;                                 ///< The name of the call site
+    const clock_type::time_point start;                     ///< The start of the call
+    std::mutex lock;                                        ///< The lock protecting the durations
+    std::vector<double> chunks;                             ///< The duration of each chunk
+    std::vector<std::pair<std::thread::id, double>> busy;   ///< The busy time of each worker
+};
+
+} //end of namespace parallel_profile_detail
+
+/*!
+ * \brief A named call site for the profiler of the parallel loops.
+ *
+ * The parallel algorithms called by the current thread during the
+ * lifetime of the scope are profiled under its name.
+ */
+struct parallel_profile_scope {
+    /*!
+     * \brief Enter the scope with the given name. The name must outlive the scope.
+     */
+    explicit parallel_profile_scope(const char* name) : saved(parallel_profile_detail::current_scope) {
+        parallel_profile_detail::current_scope = name;
+    }
+
+    parallel_profile_scope(const parallel_profile_scope& rhs) = delete;
+    parallel_profile_scope& operator=(const parallel_profile_scope& rhs) = delete;
+
+    /*!
+     * \brief Leave the scope
+     */
+    ~parallel_profile_scope() {
+        parallel_profile_detail::current_scope = saved;
+    }
+
+private:
+    const char* const saved; ///< The enclosing scope
+};
+
+/*!
+ * \brief Returns the profiles of all the call sites, sorted by name
+ */
+inline std::vector<parallel_site_profile> parallel_profile_sites() {
+    auto& r = parallel_profile_detail::registry::get();
+
+    std::unique_lock<std::mutex> l(r.lock);
+
+    std::vector<parallel_site_profile> sites;
+
+    for (auto& [name, site] : r.sites) {
+        sites.push_back(site);
+    }
+
+    return sites;
+}
+
+/*!
+ * \brief Discard all the recorded profiles
+ */
+inline void parallel_profile_reset() {
+    auto& r = parallel_profile_detail::registry::get();
+
+    std::unique_lock<std::mutex> l(r.lock);
+
+    r.sites.clear();
+}
+
+/*!
+ * \brief Print the profiles of all the call sites, the durations per call
+ * being averaged over the calls.
+ * \param out The stream to print to
+ */
+inline void parallel_profile_report(std::ostream& out = std::cout) {
+    auto us = [](double ns, std::size_t n) { return n ? ns / n / 1000.0 : 0.0; };
+
+    for (auto& site : parallel_profile_sites()) {
+        out << site.name << ": " << site.calls << " calls" << std::fixed << std::setprecision(2)
+            << ", " << (double(site.chunks) / site.calls) << " chunks/call"
+            << ", " << (double(site.workers) / site.calls) << " workers/call" << std::endl;
+        out << "    chunk: mean " << us(site.busy_ns, site.chunks) << "us, min " << (site.chunk_min_ns / 1000.0)
+            << "us, max " << (site.chunk_max_ns / 1000.0) << "us" << std::endl;
+        out << "    call: wall " << us(site.wall_ns, site.calls) << "us, critical path " << us(site.critical_ns, site.calls)
+            << "us, mean worker " << us(site.mean_ns, site.calls) << "us, imbalance " << site.imbalance()
+            << ", dispatch overhead " << us(site.dispatch_ns, site.calls) << "us" << std::endl;
+        out << std::defaultfloat;
+    }
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_PARALLEL_PROFILE_HPP
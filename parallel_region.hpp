@@ -0,0 +1,356 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file parallel_region.hpp
+ * \brief Contains persistent parallel regions, in the style of OpenMP.
+ *
+ * A parallel region runs one functor per thread of the pool. The threads
+ * stay in the region until the functor returns and synchronize with
+ * barriers, which is much cheaper than submitting new tasks to the thread
+ * pool for each step of an iterative algorithm:
+ *
+ * \code
+ * cpp::parallel_region(pool, [&](cpp::region_context& ctx) {
+ *     for (std::size_t it = 0; it < iterations; ++it) {
+ *         ctx.for_range(0, n, [&](std::size_t i) { next[i] = step(current, i); });
+ *         ctx.single([&]() { std::swap(current, next); });
+ *     }
+ * });
+ * \endcode
+ */
+
+#ifndef CPP_UTILS_PARALLEL_REGION_HPP
+#define CPP_UTILS_PARALLEL_REGION_HPP
+
+#ifdef CPP_UTILS_NO_EXCEPT
+#include <iostream>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+#include "cache_line.hpp"
+#include "futex.hpp"
+#include "parallel.hpp"
+
+namespace cpp {
+
+namespace region_detail {
+
+/*!
+ * \brief The number of times a thread spins on a barrier before sleeping.
+ *
+ * The steps of iterative algorithms are generally short and well
+ * balanced, spinning a bit longer avoids most of the system calls.
+ */
+constexpr std::size_t spin_count = 4096;
+
+/*!
+ * \brief The exception leaving the region on the threads waiting on a
+ * cancelled barrier. It is never seen outside of parallel_region.
+ */
+struct cancelled {};
+
+/*!
+ * \brief A centralized sense-reversing barrier.
+ *
+ * The sense is the generation counter: the last thread to arrive resets
+ * the count and flips the sense by incrementing the generation, which
+ * releases the other threads. Waiting threads spin on the generation and
+ * then sleep on an event count.
+ *
+ * When a thread of the region throws, the barrier is cancelled: the
+ * threads waiting on it, or arriving later, leave the region with the
+ * cancelled exception.
+ */
+struct barrier {
+    /*!
+     * \brief Construct a barrier for the given number of threads
+     */
+    explicit barrier(std::size_t n) : n(n) {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Wait for all the threads to arrive at the barrier
+     */
+    void arrive_and_wait() {
+        const auto sense = generation->load(std::memory_order_acquire);
+
+        check_cancelled();
+
+        if (count->fetch_add(1, std::memory_order_acq_rel) + 1 == n) {
+            count->store(0, std::memory_order_relaxed);
+            generation->fetch_add(1, std::memory_order_release);
+            event.notify_all();
+            return;
+        }
+
+        for (std::size_t i = 0; i < spin_count; ++i) {
+            if (released(sense)) {
+                check_cancelled();
+                return;
+            }
+        }
+
+        while (!released(sense)) {
+            auto key = event.prepare_wait();
+
+            if (released(sense)) {
+                event.cancel_wait();
+                break;
+            }
+
+            event.wait(key);
+        }
+
+        check_cancelled();
+    }
+
+    /*!
+     * \brief Cancel the barrier, releasing all the waiting threads
+     */
+    void cancel() {
+        broken.store(true, std::memory_order_release);
+        event.notify_all();
+    }
+
+private:
+    /*!
+     * \brief Indicates if the threads waiting for the given sense can leave the barrier
+     */
+    bool released(std::uint32_t sense) const {
+        return generation->load(std::memory_order_acquire) != sense || broken.load(std::memory_order_acquire);
+    }
+
+    /*!
+     * \brief Leave the region if the barrier has been cancelled
+     */
+    void check_cancelled() const {
+#ifndef CPP_UTILS_NO_EXCEPT
+        if (broken.load(std::memory_order_acquire)) {
+            throw region_detail::cancelled();
+        }
+#endif
+    }
+
+    const std::size_t n;                                    ///< The number of threads
+    cache_padded<std::atomic<std::size_t>> count{0};        ///< The number of arrived threads
+    cache_padded<std::atomic<std::uint32_t>> generation{0}; ///< The sense of the barrier
+    std::atomic<bool> broken{false};                        ///< Indicates if a thread of the region has thrown
+    event_count event;                                      ///< The event to sleep on
+};
+
+/*!
+ * \brief Start a thread of the region on the thread pool.
+ *
+ * All the threads of a region must run at the same time, a thread
+ * rejected by the thread pool cannot be executed later by the caller: it
+ * is an error.
+ */
+template <typename TP, typename Functor>
+void start(TP& thread_pool, Functor fun) {
+    if constexpr (requires { thread_pool.try_do_task(fun); }) {
+        if (!thread_pool.try_do_task(fun)) {
+#ifndef CPP_UTILS_NO_EXCEPT
+            throw std::runtime_error("cpp_utils: parallel_region rejected by the thread pool");
+#else
+            std::cerr << "cpp_utils: parallel_region rejected by the thread pool (exceptions disabled)" << std::endl;
+            std::abort();
+#endif
+        }
+    } else {
+        thread_pool.do_task(fun);
+    }
+}
+
+} //end of namespace region_detail
+
+/*!
+ * \brief The context of one thread inside a parallel region
+ */
+struct region_context {
+    /*!
+     * \brief Construct the context of the given thread
+     * \param barrier The barrier of the region
+     * \param index The index of the thread
+     * \param threads The number of threads in the region
+     */
+    region_context(region_detail::barrier& barrier, std::size_t index, std::size_t threads)
+            : region_barrier(barrier), index(index), threads(threads) {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Returns the index of the current thread, in [0, num_threads())
+     */
+    std::size_t thread_index() const {
+        return index;
+    }
+
+    /*!
+     * \brief Returns the number of threads in the region
+     */
+    std::size_t num_threads() const {
+        return threads;
+    }
+
+    /*!
+     * \brief Wait for all the threads of the region to reach this barrier
+     */
+    void barrier() {
+        region_barrier.arrive_and_wait();
+    }
+
+    /*!
+     * \brief Share the [first, last) range between the threads of the
+     * region, without waiting at the end.
+     *
+     * Each thread calls the functor for the indices of its own contiguous
+     * block. All the threads of the region must call this function.
+     *
+     * \param first The beginning of the range
+     * \param last The end of the range
+     * \param fun The functor to call for each index
+     */
+    template <typename Functor>
+    void for_range_nowait(std::size_t first, std::size_t last, Functor&& fun) {
+        const std::size_t n = last - first;
+
+        for (std::size_t i = first + n * index / threads; i < first + n * (index + 1) / threads; ++i) {
+            fun(i);
+        }
+    }
+
+    /*!
+     * \brief Share the [first, last) range between the threads of the
+     * region and wait for all the threads to be done.
+     *
+     * All the threads of the region must call this function.
+     *
+     * \param first The beginning of the range
+     * \param last The end of the range
+     * \param fun The functor to call for each index
+     */
+    template <typename Functor>
+    void for_range(std::size_t first, std::size_t last, Functor&& fun) {
+        for_range_nowait(first, last, fun);
+        barrier();
+    }
+
+    /*!
+     * \brief Call the functor on the first thread of the region only and
+     * wait for it to be done.
+     *
+     * All the threads of the region must call this function.
+     *
+     * \param fun The functor to call
+     */
+    template <typename Functor>
+    void single(Functor&& fun) {
+        if (index == 0) {
+            fun();
+        }
+
+        barrier();
+    }
+
+private:
+    region_detail::barrier& region_barrier; ///< The barrier of the region
+    const std::size_t index;                ///< The index of the thread
+    const std::size_t threads;              ///< The number of threads
+};
+
+/*!
+ * \brief Run the functor concurrently on all the threads of the pool, as
+ * a persistent parallel region.
+ *
+ * The functor is called once per thread with its region_context. The
+ * calling thread runs the first thread of the region and the thread pool
+ * the others. The thread pool must not be running other tasks since all
+ * the threads of the region must run at the same time for the barriers to
+ * complete. If the thread pool rejects one of the threads of the region
+ * (see overflow_policy), the region is cancelled and an error is raised.
+ *
+ * If the functor throws on one of the threads, the barriers of the region
+ * are cancelled so that the other threads leave the region as soon as
+ * they reach one of them. The first exception is rethrown once all the
+ * threads have left the region.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param fun The functor to run, called with a region_context&
+ */
+template <typename TP, typename Functor>
+void parallel_region(TP& thread_pool, Functor fun) {
+    const std::size_t threads = std::max(std::size_t(1), thread_pool.size());
+
+    region_detail::barrier barrier(threads);
+
+    std::exception_ptr error; // The first exception thrown in the region
+    std::mutex lock;          // The lock protecting error
+
+    auto body = [&barrier, &fun, &error, &lock, threads](std::size_t t) {
+        region_context context(barrier, t, threads);
+
+#ifndef CPP_UTILS_NO_EXCEPT
+        try {
+            fun(context);
+        } catch (const region_detail::cancelled&) {
+            // Another thread has thrown
+        } catch (...) {
+            {
+                std::unique_lock<std::mutex> l(lock);
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+
+            barrier.cancel();
+        }
+#else
+        cpp_unused(error);
+        cpp_unused(lock);
+        fun(context);
+#endif
+    };
+
+#ifndef CPP_UTILS_NO_EXCEPT
+    try {
+        for (std::size_t t = 1; t < threads; ++t) {
+            region_detail::start(thread_pool, [&body, t]() { body(t); });
+        }
+    } catch (...) {
+        // The threads already started refer to this frame
+        barrier.cancel();
+        thread_pool.wait();
+        throw;
+    }
+#else
+    for (std::size_t t = 1; t < threads; ++t) {
+        region_detail::start(thread_pool, [&body, t]() { body(t); });
+    }
+#endif
+
+    body(0);
+
+    thread_pool.wait();
+
+#ifndef CPP_UTILS_NO_EXCEPT
+    if (error) {
+        std::rethrow_exception(error);
+    }
+#endif
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_PARALLEL_REGION_HPP
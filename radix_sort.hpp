@@ -0,0 +1,346 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file radix_sort.hpp
+ * \brief Contains a parallel LSD radix sort for integer and floating point keys.
+ *
+ * The keys are sorted one byte at a time, from the least significant one.
+ * Each pass counts the digits of each block of keys in private histograms,
+ * computes the output position of each (digit, block) pair with a scan of
+ * the histograms and then scatters the blocks concurrently, through
+ * software write-combining buffers so that the writes are done one cache
+ * line at a time instead of one key at a time.
+ */
+
+#ifndef CPP_UTILS_RADIX_SORT_HPP
+#define CPP_UTILS_RADIX_SORT_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "assert.hpp"
+#include "cache_line.hpp"
+#include "parallel.hpp"
+
+namespace cpp {
+
+namespace radix_detail {
+
+constexpr std::size_t radix_bits = 8;                   ///< The number of bits of a digit
+constexpr std::size_t radix      = 1 << radix_bits;     ///< The number of different digits
+constexpr std::size_t min_block  = std::size_t(1) << 14; ///< The minimum number of keys per block
+
+/*!
+ * \brief The unsigned integer type of the given size
+ */
+template <std::size_t S>
+using uint_t = std::conditional_t<S == 1, uint8_t, std::conditional_t<S == 2, uint16_t, std::conditional_t<S == 4, uint32_t, uint64_t>>>;
+
+/*!
+ * \brief Indicates if the given type can be used as a key of the radix sort
+ */
+template <typename Key>
+constexpr bool is_radix_key = std::is_arithmetic_v<Key> && !std::is_same_v<Key, bool> && (sizeof(Key) == 1 || sizeof(Key) == 2 || sizeof(Key) == 4 || sizeof(Key) == 8);
+
+/*!
+ * \brief Returns the unsigned bits of the key, ordered as the key.
+ *
+ * The sign bit of signed integers is flipped. The sign bit of positive
+ * floating point numbers is set and all the bits of negative ones are
+ * flipped, which orders -0.0 before +0.0, negative NaNs first and
+ * positive NaNs last.
+ */
+template <typename Key>
+uint_t<sizeof(Key)> ordered_bits(Key key) {
+    using bits_t = uint_t<sizeof(Key)>;
+
+    constexpr bits_t sign = bits_t(1) << (sizeof(Key) * 8 - 1);
+
+    if constexpr (std::is_floating_point_v<Key>) {
+        const auto bits = std::bit_cast<bits_t>(key);
+        return (bits & sign) ? bits_t(~bits) : bits_t(bits | sign);
+    } else if constexpr (std::is_signed_v<Key>) {
+        return static_cast<bits_t>(static_cast<bits_t>(key) ^ sign);
+    } else {
+        return key;
+    }
+}
+
+/*!
+ * \brief Returns the digit of the key for the given pass
+ */
+template <typename Key>
+std::size_t digit(Key key, std::size_t pass) {
+    return (ordered_bits(key) >> (pass * radix_bits)) & (radix - 1);
+}
+
+/*!
+ * \brief Count the digits of the given pass in [first, last) into counts
+ */
+template <typename Key>
+void count_digits(const Key* first, const Key* last, std::size_t pass, std::size_t* counts) {
+    std::fill_n(counts, radix, 0);
+
+    for (; first != last; ++first) {
+        ++counts[digit(*first, pass)];
+    }
+}
+
+/*!
+ * \brief Sort, concurrently, the n keys and, if KV, the n values in the same order.
+ */
+template <bool KV, typename TP, typename Key, typename Value>
+void radix_sort(TP& thread_pool, Key* keys, Value* values, std::size_t n) {
+    constexpr std::size_t passes = sizeof(Key);
+
+    // The number of keys (and values) in one write-combining line
+    constexpr std::size_t wc = std::max(std::size_t(1), cache_line_size / sizeof(Key));
+
+    // Trivial values are buffered as the keys, the others are directly moved to their final position
+    constexpr bool buffer_values = KV && std::is_trivially_copyable_v<Value> && std::is_default_constructible_v<Value>;
+
+    if (n < 2) {
+        return;
+    }
+
+    const std::size_t blocks = std::max(std::size_t(1), std::min(thread_pool.size(), n / min_block));
+
+    // 1. Compute the histograms of all the passes at once, to skip the passes with a single digit
+
+    aligned_vector<std::size_t, cache_line_size> counts(blocks * passes * radix);
+
+    parallel_detail::for_each_block(thread_pool, n, blocks, [keys, &counts](std::size_t b, std::size_t first, std::size_t last) {
+        auto* block_counts = counts.data() + b * passes * radix;
+
+        for (std::size_t i = first; i < last; ++i) {
+            const auto bits = ordered_bits(keys[i]);
+
+            for (std::size_t pass = 0; pass < passes; ++pass) {
+                ++block_counts[pass * radix + ((bits >> (pass * radix_bits)) & (radix - 1))];
+            }
+        }
+    });
+
+    std::array<bool, passes> needed;
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        std::array<std::size_t, radix> global{};
+
+        for (std::size_t b = 0; b < blocks; ++b) {
+            for (std::size_t d = 0; d < radix; ++d) {
+                global[d] += counts[(b * passes + pass) * radix + d];
+            }
+        }
+
+        needed[pass] = std::find(global.begin(), global.end(), n) == global.end();
+    }
+
+    // 2. Sort digit by digit, alternating between the input and temporary buffers
+
+    // Arrays rather than vectors, std::vector<bool> (bool values) has no contiguous storage
+    auto tmp_keys   = std::make_unique<Key[]>(n);
+    auto tmp_values = std::make_unique<std::conditional_t<KV, Value, char>[]>(KV ? n : 0);
+
+    aligned_vector<Key, cache_line_size> key_lines(blocks * radix * wc);
+    auto value_lines = std::make_unique<std::conditional_t<buffer_values, Value, char>[]>(buffer_values ? blocks * radix * wc : 0);
+
+    std::vector<std::size_t> offsets(blocks * radix);
+
+    Key* src_keys   = keys;
+    Key* dst_keys   = tmp_keys.get();
+    Value* src_values = nullptr;
+    Value* dst_values = nullptr;
+
+    if constexpr (KV) {
+        src_values = values;
+        dst_values = tmp_values.get();
+    }
+
+    bool first_pass = true;
+
+    for (std::size_t pass = 0; pass < passes; ++pass) {
+        if (!needed[pass]) {
+            continue;
+        }
+
+        // The histograms of the first pass have already been computed
+        if (!first_pass) {
+            parallel_detail::for_each_block(thread_pool, n, blocks, [src_keys, pass, &counts](std::size_t b, std::size_t first, std::size_t last) {
+                count_digits(src_keys + first, src_keys + last, pass, counts.data() + (b * passes + pass) * radix);
+            });
+        }
+
+        first_pass = false;
+
+        // Exclusive scan of the histograms, in (digit, block) order
+        std::size_t offset = 0;
+        for (std::size_t d = 0; d < radix; ++d) {
+            for (std::size_t b = 0; b < blocks; ++b) {
+                offsets[b * radix + d] = offset;
+                offset += counts[(b * passes + pass) * radix + d];
+            }
+        }
+
+        parallel_detail::for_each_block(thread_pool, n, blocks, [&, pass](std::size_t b, std::size_t first, std::size_t last) {
+            auto* block_offsets = offsets.data() + b * radix;
+            auto* k_lines       = key_lines.data() + b * radix * wc;
+            auto* v_lines       = buffer_values ? value_lines.get() + b * radix * wc : nullptr;
+
+            std::array<std::size_t, radix> fill{};
+
+            for (std::size_t i = first; i < last; ++i) {
+                const auto d    = digit(src_keys[i], pass);
+                const auto slot = fill[d]++;
+
+                k_lines[d * wc + slot] = src_keys[i];
+
+                if constexpr (buffer_values) {
+                    v_lines[d * wc + slot] = src_values[i];
+                } else if constexpr (KV) {
+                    dst_values[block_offsets[d] + slot] = std::move(src_values[i]);
+                }
+
+                if (slot + 1 == wc) {
+                    std::copy_n(k_lines + d * wc, wc, dst_keys + block_offsets[d]);
+
+                    if constexpr (buffer_values) {
+                        std::copy_n(v_lines + d * wc, wc, dst_values + block_offsets[d]);
+                    }
+
+                    block_offsets[d] += wc;
+                    fill[d] = 0;
+                }
+            }
+
+            for (std::size_t d = 0; d < radix; ++d) {
+                std::copy_n(k_lines + d * wc, fill[d], dst_keys + block_offsets[d]);
+
+                if constexpr (buffer_values) {
+                    std::copy_n(v_lines + d * wc, fill[d], dst_values + block_offsets[d]);
+                }
+            }
+        });
+
+        std::swap(src_keys, dst_keys);
+        std::swap(src_values, dst_values);
+    }
+
+    // 3. Move the result back into the input if it ended in the temporary buffers
+
+    if (src_keys != keys) {
+        parallel_detail::for_each_block(thread_pool, n, blocks, [&](std::size_t /*b*/, std::size_t first, std::size_t last) {
+            std::copy(src_keys + first, src_keys + last, keys + first);
+
+            if constexpr (KV) {
+                std::move(src_values + first, src_values + last, values + first);
+            }
+        });
+    }
+}
+
+} //end of namespace radix_detail
+
+/*!
+ * \brief Sort, concurrently, the range of keys [first, last) with a LSD radix sort.
+ *
+ * The keys can be integers or floating point numbers, of 8 to 64 bits.
+ * The range must be contiguous. Floating point numbers are sorted in the
+ * order of their bits: -0.0 is before +0.0, negative NaNs are first and
+ * positive NaNs are last. The passes for which all the keys share the
+ * same digit are skipped.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range of keys
+ * \param last The end of the range of keys
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Iterator>
+requires std::contiguous_iterator<Iterator>
+void parallel_radix_sort(TP& thread_pool, Iterator first, Iterator last, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using key_t = typename std::iterator_traits<Iterator>::value_type;
+
+    static_assert(radix_detail::is_radix_key<key_t>, "parallel_radix_sort requires integer or floating point keys");
+
+    radix_detail::radix_sort<false>(thread_pool, std::to_address(first), static_cast<char*>(nullptr), std::distance(first, last));
+}
+
+/*!
+ * \brief Sort, concurrently, the range of keys [first_1, last_1) with a
+ * LSD radix sort and apply the same permutation to the values
+ * [first_2, last_2).
+ *
+ * The sort is stable. The keys follow the same rules as the key-only
+ * parallel_radix_sort. Both ranges must be contiguous and of the same
+ * size.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first_1 The beginning of the range of keys
+ * \param last_1 The end of the range of keys
+ * \param first_2 The beginning of the range of values
+ * \param last_2 The end of the range of values
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename IT1, typename IT2>
+requires(std::contiguous_iterator<IT1> && std::contiguous_iterator<IT2>)
+void parallel_radix_sort(TP& thread_pool, IT1 first_1, IT1 last_1, IT2 first_2, IT2 last_2, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using key_t = typename std::iterator_traits<IT1>::value_type;
+
+    static_assert(radix_detail::is_radix_key<key_t>, "parallel_radix_sort requires integer or floating point keys");
+
+    cpp_assert(std::distance(first_1, last_1) == std::distance(first_2, last_2), "The two sequences should be of the same size");
+    cpp_unused(last_2); //Ensure no warning is issued for last_2 (used only in debug mode)
+
+    radix_detail::radix_sort<true>(thread_pool, std::to_address(first_1), std::to_address(first_2), std::distance(first_1, last_1));
+}
+
+/*!
+ * \brief Sort, concurrently, the container of keys with a LSD radix sort.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param keys The container of keys
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Container>
+void parallel_radix_sort(TP& thread_pool, Container& keys, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    parallel_radix_sort(thread_pool, begin(keys), end(keys));
+}
+
+/*!
+ * \brief Sort, concurrently, the container of keys with a LSD radix sort
+ * and apply the same permutation to the container of values.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param keys The container of keys
+ * \param values The container of values
+ * \param location The location of the call, naming the call site of the profiler
+ */
+template <typename TP, typename Container1, typename Container2>
+requires(!std::input_or_output_iterator<Container1>)
+void parallel_radix_sort(TP& thread_pool, Container1& keys, Container2& values, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    parallel_radix_sort(thread_pool, begin(keys), end(keys), begin(values), end(values));
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_RADIX_SORT_HPP
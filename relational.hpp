@@ -0,0 +1,453 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file relational.hpp
+ * \brief Contains parallel hash-based relational algorithms: distinct and join.
+ *
+ * The elements are first radix-partitioned by the high bits of their hash,
+ * with private histograms per block, a scan and a parallel scatter. The
+ * number of partitions is chosen so that the hash table of one partition
+ * fits in cache. Each partition is then processed independently, with a
+ * chained hash table built over the hashes stored during partitioning, so
+ * that no key is hashed twice and no element is copied before the output.
+ *
+ * String-like keys are hashed with the transparent string_hash.
+ */
+
+#ifndef CPP_UTILS_RELATIONAL_HPP
+#define CPP_UTILS_RELATIONAL_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "hash.hpp"
+#include "parallel.hpp"
+
+namespace cpp {
+
+namespace relational_detail {
+
+constexpr std::size_t partition_size = std::size_t(1) << 12; ///< The target number of elements per partition
+constexpr std::size_t pass_bits      = 12;                   ///< The maximum number of partitioning bits of one pass
+constexpr std::size_t max_bits       = 2 * pass_bits;        ///< The maximum number of partitioning bits
+constexpr std::size_t npos           = std::size_t(-1);      ///< The end of a chain
+
+/*!
+ * \brief The default hash function for the given type of key.
+ */
+template <typename Key>
+using hasher_t = std::conditional_t<std::is_convertible_v<const Key&, std::string_view>, string_hash, std::hash<Key>>;
+
+/*!
+ * \brief An element of a partition: its mixed hash and its index in the input
+ */
+struct entry {
+    std::size_t hash;  ///< The mixed hash of the key
+    std::size_t index; ///< The index of the element in the input
+};
+
+/*!
+ * \brief Mix a hash so that its high bits (partition) and low bits
+ * (bucket) are both well distributed (Fibonacci hashing).
+ */
+inline std::size_t mix(std::size_t hash) {
+    return static_cast<std::size_t>(static_cast<uint64_t>(hash) * UINT64_C(11400714819323198485));
+}
+
+/*!
+ * \brief Returns the number of partitioning bits for n elements, so that
+ * the partitions have about partition_size elements.
+ */
+inline std::size_t partition_bits(std::size_t n) {
+    return std::min(max_bits, static_cast<std::size_t>(std::bit_width(n / partition_size)));
+}
+
+/*!
+ * \brief The elements, grouped by partition
+ */
+struct partitions {
+    std::vector<entry> entries;     ///< The elements, partition by partition
+    std::vector<std::size_t> starts; ///< The start of each partition in entries, and the end
+
+    /*!
+     * \brief Returns the number of partitions
+     */
+    std::size_t size() const {
+        return starts.size() - 1;
+    }
+};
+
+/*!
+ * \brief Radix-partition, concurrently, the n elements by the high bits of
+ * their hash, in a single pass.
+ * \param hash_of The functor returning the hash of the element at the given index
+ */
+template <typename TP, typename Hash>
+partitions partition_once(TP& thread_pool, std::size_t n, std::size_t bits, Hash hash_of) {
+    const std::size_t parts  = std::size_t(1) << bits;
+    const std::size_t blocks = std::max(std::size_t(1), std::min(thread_pool.size(), n / partition_size));
+
+    auto part_of = [bits](std::size_t hash) { return bits ? hash >> (std::numeric_limits<std::size_t>::digits - bits) : 0; };
+
+    partitions result;
+    result.entries.resize(n);
+    result.starts.resize(parts + 1);
+
+    std::vector<std::size_t> hashes(n);
+    std::vector<std::size_t> offsets(blocks * parts);
+
+    parallel_detail::for_each_block(thread_pool, n, blocks, [&, parts](std::size_t b, std::size_t first, std::size_t last) {
+        auto* counts = offsets.data() + b * parts;
+
+        for (std::size_t i = first; i < last; ++i) {
+            hashes[i] = mix(hash_of(i));
+            ++counts[part_of(hashes[i])];
+        }
+    });
+
+    // Exclusive scan of the histograms, in (partition, block) order
+    std::size_t offset = 0;
+    for (std::size_t p = 0; p < parts; ++p) {
+        result.starts[p] = offset;
+
+        for (std::size_t b = 0; b < blocks; ++b) {
+            const auto count         = offsets[b * parts + p];
+            offsets[b * parts + p] = offset;
+            offset += count;
+        }
+    }
+
+    result.starts[parts] = offset;
+
+    parallel_detail::for_each_block(thread_pool, n, blocks, [&, parts](std::size_t b, std::size_t first, std::size_t last) {
+        auto* block_offsets = offsets.data() + b * parts;
+
+        for (std::size_t i = first; i < last; ++i) {
+            result.entries[block_offsets[part_of(hashes[i])]++] = {hashes[i], i};
+        }
+    });
+
+    return result;
+}
+
+/*!
+ * \brief Radix-partition, concurrently, the n elements by the high bits of their hash.
+ *
+ * Scattering the elements into too many partitions at once thrashes the
+ * caches and the TLB. Beyond pass_bits, the elements are first
+ * partitioned by the first pass_bits bits and each of these partitions is
+ * then partitioned by the remaining bits, the partitions being processed
+ * concurrently. The result is the same as with a single pass.
+ *
+ * \param hash_of The functor returning the hash of the element at the given index
+ */
+template <typename TP, typename Hash>
+partitions partition(TP& thread_pool, std::size_t n, std::size_t bits, Hash hash_of) {
+    if (bits <= pass_bits) {
+        return partition_once(thread_pool, n, bits, hash_of);
+    }
+
+    auto coarse = partition_once(thread_pool, n, pass_bits, hash_of);
+
+    const std::size_t coarse_parts = coarse.size();
+    const std::size_t fine_bits    = bits - pass_bits;
+    const std::size_t fine_parts   = std::size_t(1) << fine_bits;
+
+    auto fine_of = [bits, fine_parts](std::size_t hash) { return (hash >> (std::numeric_limits<std::size_t>::digits - bits)) & (fine_parts - 1); };
+
+    partitions result;
+    result.entries.resize(n);
+    result.starts.resize(coarse_parts * fine_parts + 1);
+
+    parallel_detail::for_each_block(thread_pool, coarse_parts, std::min(coarse_parts, thread_pool.size()), [&, fine_parts](std::size_t /*b*/, std::size_t first, std::size_t last) {
+        std::vector<std::size_t> offsets(fine_parts);
+
+        for (std::size_t c = first; c < last; ++c) {
+            const auto c_first = coarse.starts[c];
+            const auto c_last  = coarse.starts[c + 1];
+
+            std::fill(offsets.begin(), offsets.end(), 0);
+
+            for (std::size_t i = c_first; i < c_last; ++i) {
+                ++offsets[fine_of(coarse.entries[i].hash)];
+            }
+
+            std::size_t offset = c_first;
+            for (std::size_t f = 0; f < fine_parts; ++f) {
+                result.starts[c * fine_parts + f] = offset;
+
+                const auto count = offsets[f];
+                offsets[f]       = offset;
+                offset += count;
+            }
+
+            for (std::size_t i = c_first; i < c_last; ++i) {
+                result.entries[offsets[fine_of(coarse.entries[i].hash)]++] = coarse.entries[i];
+            }
+        }
+    });
+
+    result.starts[coarse_parts * fine_parts] = n;
+
+    return result;
+}
+
+/*!
+ * \brief A chained hash table over the entries of one partition.
+ *
+ * The table is reused from one partition to the next by the same task.
+ */
+struct chained_table {
+    /*!
+     * \brief Clear the table and prepare it for n entries
+     */
+    void reset(std::size_t n) {
+        mask = std::bit_ceil(std::max(n, std::size_t(1))) - 1;
+        heads.assign(mask + 1, npos);
+        next.resize(n);
+    }
+
+    /*!
+     * \brief Insert the entry at the given position of the partition
+     */
+    void insert(std::size_t position, std::size_t hash) {
+        auto& head     = heads[hash & mask];
+        next[position] = head;
+        head           = position;
+    }
+
+    /*!
+     * \brief Returns the first position of the chain of the given hash
+     */
+    std::size_t first(std::size_t hash) const {
+        return heads[hash & mask];
+    }
+
+    std::size_t mask = 0;           ///< The mask of the bucket index
+    std::vector<std::size_t> heads; ///< The first position of each bucket
+    std::vector<std::size_t> next;  ///< The next position in the chain of each position
+};
+
+/*!
+ * \brief Process, concurrently, the partitions, in contiguous groups of partitions per task.
+ *
+ * Each task produces a vector of results per partition, which are then
+ * concatenated, concurrently, in partition order.
+ *
+ * \param fun The functor called with (table, partition, results) for each partition
+ */
+template <typename T, typename TP, typename Functor>
+std::vector<T> for_each_partition(TP& thread_pool, std::size_t parts, Functor fun) {
+    std::vector<std::vector<T>> results(parts);
+
+    parallel_detail::for_each_block(thread_pool, parts, std::min(parts, thread_pool.size()), [&fun, &results](std::size_t /*b*/, std::size_t first, std::size_t last) {
+        chained_table table;
+
+        for (std::size_t p = first; p < last; ++p) {
+            fun(table, p, results[p]);
+        }
+    });
+
+    std::vector<std::size_t> offsets(parts + 1);
+    for (std::size_t p = 0; p < parts; ++p) {
+        offsets[p + 1] = offsets[p] + results[p].size();
+    }
+
+    std::vector<T> output(offsets[parts]);
+
+    parallel_detail::for_each_block(thread_pool, parts, std::min(parts, thread_pool.size()), [&results, &offsets, &output](std::size_t /*b*/, std::size_t first, std::size_t last) {
+        for (std::size_t p = first; p < last; ++p) {
+            std::move(results[p].begin(), results[p].end(), output.begin() + offsets[p]);
+        }
+    });
+
+    return output;
+}
+
+} //end of namespace relational_detail
+
+/*!
+ * \brief Returns, concurrently, the distinct elements of [first, last).
+ *
+ * The elements are radix-partitioned by hash, and the distinct elements
+ * of each partition are found with a hash table fitting in cache. The
+ * order of the distinct elements is unspecified. String-like elements are
+ * hashed with string_hash by default.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The beginning of the range
+ * \param last The end of the range
+ * \param hash The hash function
+ * \param eq The equality predicate
+ * \param location The location of the call, naming the call site of the profiler
+ * \return A vector with one copy of each distinct element
+ */
+template <typename TP, typename Iterator, typename Hash = relational_detail::hasher_t<typename std::iterator_traits<Iterator>::value_type>, typename KeyEqual = std::equal_to<>>
+auto parallel_distinct(TP& thread_pool, Iterator first, Iterator last, Hash hash = Hash(), KeyEqual eq = KeyEqual(), call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+
+    static_assert(parallel_detail::is_random_access<Iterator>, "parallel_distinct requires random access iterators");
+
+    const std::size_t n = std::distance(first, last);
+
+    auto parts = relational_detail::partition(thread_pool, n, relational_detail::partition_bits(n), [first, &hash](std::size_t i) { return hash(first[i]); });
+
+    auto indices = relational_detail::for_each_partition<std::size_t>(thread_pool, parts.size(), [first, &eq, &parts](auto& table, std::size_t p, auto& distinct) {
+        const auto* entries  = parts.entries.data() + parts.starts[p];
+        const std::size_t pn = parts.starts[p + 1] - parts.starts[p];
+
+        table.reset(pn);
+
+        for (std::size_t e = 0; e < pn; ++e) {
+            bool found = false;
+
+            for (auto c = table.first(entries[e].hash); c != relational_detail::npos; c = table.next[c]) {
+                if (entries[c].hash == entries[e].hash && eq(first[entries[c].index], first[entries[e].index])) {
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found) {
+                table.insert(e, entries[e].hash);
+                distinct.push_back(entries[e].index);
+            }
+        }
+    });
+
+    std::vector<value_type> distinct(indices.size());
+
+    if (!indices.empty()) {
+        parallel_detail::for_each_block(thread_pool, indices.size(), std::min(indices.size(), thread_pool.size()), [first, &indices, &distinct](std::size_t /*b*/, std::size_t i_first, std::size_t i_last) {
+            for (std::size_t i = i_first; i < i_last; ++i) {
+                distinct[i] = first[indices[i]];
+            }
+        });
+    }
+
+    return distinct;
+}
+
+/*!
+ * \brief Returns, concurrently, the distinct elements of the container.
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param container The container
+ * \param location The location of the call, naming the call site of the profiler
+ * \return A vector with one copy of each distinct element
+ */
+template <typename TP, typename Container>
+auto parallel_distinct(TP& thread_pool, const Container& container, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_distinct(thread_pool, begin(container), end(container));
+}
+
+/*!
+ * \brief Join, concurrently, two ranges on equal keys (inner hash join).
+ *
+ * Both sides are radix-partitioned by the hash of their keys, with the
+ * same number of partitions. For each partition, a hash table is built
+ * over the build side and probed with the probe side. The build side
+ * should be the smaller side. The order of the pairs is unspecified.
+ * String-like keys are hashed with the transparent string_hash, so that
+ * for instance std::string and std::string_view keys can be joined.
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param build_first The beginning of the build range
+ * \param build_last The end of the build range
+ * \param probe_first The beginning of the probe range
+ * \param probe_last The end of the probe range
+ * \param build_key The functor returning the key of a build element
+ * \param probe_key The functor returning the key of a probe element
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The (build index, probe index) pairs of the elements with equal keys
+ */
+template <typename TP, typename Iterator1, typename Iterator2, typename BuildKey, typename ProbeKey>
+std::vector<std::pair<std::size_t, std::size_t>> parallel_hash_join(TP& thread_pool, Iterator1 build_first, Iterator1 build_last, Iterator2 probe_first, Iterator2 probe_last, BuildKey build_key, ProbeKey probe_key, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using key_t = std::decay_t<decltype(build_key(*build_first))>;
+
+    static_assert(parallel_detail::is_random_access<Iterator1> && parallel_detail::is_random_access<Iterator2>, "parallel_hash_join requires random access iterators");
+
+    const std::size_t m = std::distance(build_first, build_last);
+    const std::size_t n = std::distance(probe_first, probe_last);
+
+    // The partitions are sized for the build side, which holds the hash tables
+    const std::size_t bits = relational_detail::partition_bits(m);
+
+    relational_detail::hasher_t<key_t> hash;
+    std::equal_to<> eq;
+
+    auto build = relational_detail::partition(thread_pool, m, bits, [=, &hash](std::size_t i) { return hash(build_key(build_first[i])); });
+    auto probe = relational_detail::partition(thread_pool, n, bits, [=, &hash](std::size_t i) { return hash(probe_key(probe_first[i])); });
+
+    return relational_detail::for_each_partition<std::pair<std::size_t, std::size_t>>(thread_pool, build.size(), [&](auto& table, std::size_t p, auto& pairs) {
+        const auto* b_entries = build.entries.data() + build.starts[p];
+        const std::size_t bn  = build.starts[p + 1] - build.starts[p];
+
+        const auto* p_entries = probe.entries.data() + probe.starts[p];
+        const std::size_t pn  = probe.starts[p + 1] - probe.starts[p];
+
+        if (!bn || !pn) {
+            return;
+        }
+
+        table.reset(bn);
+
+        // Insert in reverse order so that the chains are in input order
+        for (std::size_t e = bn; e-- > 0;) {
+            table.insert(e, b_entries[e].hash);
+        }
+
+        for (std::size_t e = 0; e < pn; ++e) {
+            const auto& key = probe_key(probe_first[p_entries[e].index]);
+
+            for (auto c = table.first(p_entries[e].hash); c != relational_detail::npos; c = table.next[c]) {
+                if (b_entries[c].hash == p_entries[e].hash && eq(build_key(build_first[b_entries[c].index]), key)) {
+                    pairs.emplace_back(b_entries[c].index, p_entries[e].index);
+                }
+            }
+        }
+    });
+}
+
+/*!
+ * \brief Join, concurrently, two containers on equal keys (inner hash join).
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param build The build container, the smaller one
+ * \param probe The probe container
+ * \param build_key The functor returning the key of a build element
+ * \param probe_key The functor returning the key of a probe element
+ * \param location The location of the call, naming the call site of the profiler
+ * \return The (build index, probe index) pairs of the elements with equal keys
+ */
+template <typename TP, typename Container1, typename Container2, typename BuildKey, typename ProbeKey>
+std::vector<std::pair<std::size_t, std::size_t>> parallel_hash_join(TP& thread_pool, const Container1& build, const Container2& probe, BuildKey build_key, ProbeKey probe_key, call_site location = {}) {
+    parallel_detail::site_scope scope(location);
+
+    using std::begin;
+    using std::end;
+    return parallel_hash_join(thread_pool, begin(build), end(build), begin(probe), end(probe), build_key, probe_key);
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_RELATIONAL_HPP
@@ -0,0 +1,757 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file ring_buffer.hpp
+ * \brief Contains bounded lock-free ring buffers to pass items between threads.
+ */
+
+#ifndef CPP_UTILS_RING_BUFFER_HPP
+#define CPP_UTILS_RING_BUFFER_HPP
+
+#ifdef CPP_UTILS_NO_EXCEPT
+#include <iostream>
+#else
+#include <stdexcept>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "assert.hpp"
+#include "cache_line.hpp"
+#include "futex.hpp"
+
+namespace cpp {
+
+/*!
+ * \brief Waiting policy for the blocking operations of the ring buffers:
+ * spin (yielding the processor) until the operation can be done.
+ *
+ * The non-blocking operations never pay for any notification.
+ */
+struct wait_spin {};
+
+/*!
+ * \brief Waiting policy for the blocking operations of the ring buffers:
+ * spin for a short time and then sleep on a futex.
+ *
+ * Each successful operation pays for a full fence to check for waiters.
+ */
+struct wait_futex {};
+
+namespace ring_buffer_detail {
+
+/*!
+ * \brief The number of times a blocking operation spins before sleeping.
+ */
+constexpr std::size_t spin_count = 128;
+
+/*!
+ * \brief Report a push on a full ring buffer through the queue interface.
+ */
+[[noreturn]] inline void full_error() {
+#ifndef CPP_UTILS_NO_EXCEPT
+    throw std::length_error("cpp_utils: emplace_back on full ring buffer");
+#else
+    std::cerr << "cpp_utils: emplace_back on full ring buffer (exceptions disabled)" << std::endl;
+    std::abort();
+#endif
+}
+
+/*!
+ * \brief Wait until the given condition is true.
+ *
+ * \param event The event notified when the condition may have changed
+ * \param condition The condition to wait for
+ */
+template <typename Wait, typename Condition>
+void wait_until(event_count& event, Condition condition) {
+    for (std::size_t i = 0; i < spin_count; ++i) {
+        if (condition()) {
+            return;
+        }
+    }
+
+    while (!condition()) {
+        if constexpr (std::is_same_v<Wait, wait_futex>) {
+            auto key = event.prepare_wait();
+
+            if (condition()) {
+                event.cancel_wait();
+                return;
+            }
+
+            event.wait(key);
+        } else {
+            cpp_unused(event);
+            std::this_thread::yield();
+        }
+    }
+}
+
+} //end of namespace ring_buffer_detail
+
+/*!
+ * \brief A bounded lock-free Single-Producer Single-Consumer ring buffer.
+ *
+ * The capacity is always rounded up to a power of two. The producer and
+ * consumer indices are stored on separate cache lines and each side keeps
+ * a cached copy of the other index to avoid touching the shared line on
+ * each operation.
+ *
+ * The ring buffer can also be used as queue_t of a default_thread_pool
+ * (front(), pop_front(), emplace_back()). In that case, emplace_back()
+ * fails (throws) when the ring buffer is full.
+ *
+ * \tparam T The type of items
+ * \tparam Allocator The allocator used for the storage
+ * \tparam Wait The waiting policy of the blocking operations
+ */
+template <typename T, typename Allocator = std::allocator<T>, typename Wait = wait_spin>
+struct spsc_ring_buffer {
+    using value_type     = T;         ///< The type of items
+    using allocator_type = Allocator; ///< The allocator type
+    using size_type      = std::size_t; ///< The size type
+
+    static constexpr std::size_t default_capacity = 1024; ///< The capacity when none is given
+
+    /*!
+     * \brief Construct a ring buffer.
+     * \param capacity The minimum capacity of the ring buffer
+     * \param alloc The allocator to use
+     */
+    explicit spsc_ring_buffer(std::size_t capacity = default_capacity, const Allocator& alloc = Allocator())
+            : allocator(alloc), mask(std::bit_ceil(capacity < 2 ? std::size_t(2) : capacity) - 1) {
+        slots = std::allocator_traits<Allocator>::allocate(allocator, mask + 1);
+    }
+
+    spsc_ring_buffer(const spsc_ring_buffer& rhs) = delete;
+    spsc_ring_buffer& operator=(const spsc_ring_buffer& rhs) = delete;
+
+    /*!
+     * \brief Destroy the remaining items and release the storage
+     */
+    ~spsc_ring_buffer() {
+        for (auto i = head.load(std::memory_order_relaxed); i != tail.load(std::memory_order_relaxed); ++i) {
+            std::allocator_traits<Allocator>::destroy(allocator, slots + (i & mask));
+        }
+
+        std::allocator_traits<Allocator>::deallocate(allocator, slots, mask + 1);
+    }
+
+    /*!
+     * \brief Returns the number of items the ring buffer can hold
+     */
+    std::size_t capacity() const noexcept {
+        return mask + 1;
+    }
+
+    /*!
+     * \brief Returns the number of items currently in the ring buffer.
+     *
+     * The value is only a snapshot when the other side is active.
+     */
+    std::size_t size() const noexcept {
+        auto h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+    /*!
+     * \brief Indicates if the ring buffer is currently empty
+     */
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Producer side
+
+    /*!
+     * \brief Try to construct a new item at the end of the ring buffer.
+     * \return true if the item was inserted, false if the ring buffer was full
+     */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        const auto t = tail.load(std::memory_order_relaxed);
+
+        if (t - head_cache > mask) {
+            head_cache = head.load(std::memory_order_acquire);
+
+            if (t - head_cache > mask) {
+                return false;
+            }
+        }
+
+        std::allocator_traits<Allocator>::construct(allocator, slots + (t & mask), std::forward<Args>(args)...);
+        tail.store(t + 1, std::memory_order_release);
+
+        notify(not_empty);
+
+        return true;
+    }
+
+    /*!
+     * \brief Try to push the given item at the end of the ring buffer.
+     * \return true if the item was inserted, false if the ring buffer was full
+     */
+    bool try_push(const T& value) {
+        return try_emplace(value);
+    }
+
+    /*!
+     * \copydoc try_push
+     */
+    bool try_push(T&& value) {
+        return try_emplace(std::move(value));
+    }
+
+    /*!
+     * \brief Push as many items as possible from the given range.
+     * \param first The beginning of the items to push
+     * \param n The number of items to push
+     * \return The number of items that have been pushed
+     */
+    template <typename Iterator>
+    std::size_t try_push_n(Iterator first, std::size_t n) {
+        const auto t = tail.load(std::memory_order_relaxed);
+
+        if (capacity() - (t - head_cache) < n) {
+            head_cache = head.load(std::memory_order_acquire);
+        }
+
+        const auto k = std::min(n, capacity() - (t - head_cache));
+
+        for (std::size_t i = 0; i < k; ++i, ++first) {
+            std::allocator_traits<Allocator>::construct(allocator, slots + ((t + i) & mask), *first);
+        }
+
+        if (k) {
+            tail.store(t + k, std::memory_order_release);
+            notify(not_empty);
+        }
+
+        return k;
+    }
+
+    /*!
+     * \brief Push the given item, waiting for room if necessary
+     */
+    template <typename... Args>
+    void push(Args&&... args) {
+        while (!try_emplace(std::forward<Args>(args)...)) {
+            ring_buffer_detail::wait_until<Wait>(not_full, [this] { return size() < capacity(); });
+        }
+    }
+
+    // Consumer side
+
+    /*!
+     * \brief Try to pop the first item of the ring buffer.
+     * \param value The variable receiving the item
+     * \return true if an item was popped, false if the ring buffer was empty
+     */
+    bool try_pop(T& value) {
+        const auto h = head.load(std::memory_order_relaxed);
+
+        if (h == tail_cache) {
+            tail_cache = tail.load(std::memory_order_acquire);
+
+            if (h == tail_cache) {
+                return false;
+            }
+        }
+
+        value = std::move(slots[h & mask]);
+        std::allocator_traits<Allocator>::destroy(allocator, slots + (h & mask));
+        head.store(h + 1, std::memory_order_release);
+
+        notify(not_full);
+
+        return true;
+    }
+
+    /*!
+     * \brief Pop as many items as possible, up to n.
+     * \param out The output iterator receiving the items
+     * \param n The maximum number of items to pop
+     * \return The number of items that have been popped
+     */
+    template <typename OutputIterator>
+    std::size_t try_pop_n(OutputIterator out, std::size_t n) {
+        const auto h = head.load(std::memory_order_relaxed);
+
+        if (tail_cache - h < n) {
+            tail_cache = tail.load(std::memory_order_acquire);
+        }
+
+        const auto k = std::min(n, tail_cache - h);
+
+        for (std::size_t i = 0; i < k; ++i, ++out) {
+            *out = std::move(slots[(h + i) & mask]);
+            std::allocator_traits<Allocator>::destroy(allocator, slots + ((h + i) & mask));
+        }
+
+        if (k) {
+            head.store(h + k, std::memory_order_release);
+            notify(not_full);
+        }
+
+        return k;
+    }
+
+    /*!
+     * \brief Pop the first item, waiting for one if necessary
+     */
+    T pop() {
+        ring_buffer_detail::wait_until<Wait>(not_empty, [this] { return !empty(); });
+
+        T value(std::move(front()));
+        pop_front();
+        return value;
+    }
+
+    // queue_t interface
+
+    /*!
+     * \brief Returns a reference to the first item. The ring buffer must not be empty.
+     */
+    T& front() {
+        cpp_assert(!empty(), "front() on empty ring buffer");
+        return slots[head.load(std::memory_order_relaxed) & mask];
+    }
+
+    /*!
+     * \brief Remove the first item. The ring buffer must not be empty.
+     */
+    void pop_front() {
+        cpp_assert(!empty(), "pop_front() on empty ring buffer");
+
+        const auto h = head.load(std::memory_order_relaxed);
+        std::allocator_traits<Allocator>::destroy(allocator, slots + (h & mask));
+        head.store(h + 1, std::memory_order_release);
+
+        // The item was there, so the cached tail must stay a lower bound of the tail
+        tail_cache = std::max(tail_cache, h + 1);
+
+        notify(not_full);
+    }
+
+    /*!
+     * \brief Construct a new item at the end of the ring buffer, throws if it is full.
+     */
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (!try_emplace(std::forward<Args>(args)...)) {
+            ring_buffer_detail::full_error();
+        }
+    }
+
+    /*!
+     * \brief Push a new item at the end of the ring buffer, throws if it is full.
+     */
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    /*!
+     * \copydoc push_back
+     */
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+private:
+    static void notify(event_count& event) {
+        if constexpr (std::is_same_v<Wait, wait_futex>) {
+            event.notify_one();
+        } else {
+            cpp_unused(event);
+        }
+    }
+
+    // Read-only after construction
+    alignas(cache_line_size) Allocator allocator; ///< The allocator
+    const std::size_t mask;                       ///< capacity - 1
+    T* slots = nullptr;                           ///< The storage
+
+    // Producer cache line
+    alignas(cache_line_size) std::atomic<std::size_t> tail{0}; ///< The next position to write
+    std::size_t head_cache = 0;                                ///< The last known value of head
+
+    // Consumer cache line
+    alignas(cache_line_size) std::atomic<std::size_t> head{0}; ///< The next position to read
+    std::size_t tail_cache = 0;                                ///< The last known value of tail
+
+    alignas(cache_line_size) event_count not_empty; ///< Notified when items are pushed
+    alignas(cache_line_size) event_count not_full;  ///< Notified when items are popped
+};
+
+/*!
+ * \brief A bounded lock-free Multiple-Producer Single-Consumer ring buffer.
+ *
+ * Each slot holds a sequence number indicating whether it is ready to be
+ * written or read in the current lap, so that producers only contend on the
+ * tail index. The capacity is always rounded up to a power of two.
+ *
+ * The ring buffer can also be used as queue_t of a default_thread_pool
+ * (front(), pop_front(), emplace_back()). In that case, emplace_back()
+ * fails (throws) when the ring buffer is full.
+ *
+ * \tparam T The type of items
+ * \tparam Allocator The allocator used for the storage
+ * \tparam Wait The waiting policy of the blocking operations
+ */
+template <typename T, typename Allocator = std::allocator<T>, typename Wait = wait_spin>
+struct mpsc_ring_buffer {
+    using value_type     = T;         ///< The type of items
+    using allocator_type = Allocator; ///< The allocator type
+    using size_type      = std::size_t; ///< The size type
+
+    static constexpr std::size_t default_capacity = 1024; ///< The capacity when none is given
+
+private:
+    /*!
+     * \brief A slot of the ring buffer
+     */
+    struct cell {
+        std::atomic<std::size_t> sequence;                ///< The sequence number of the slot
+        alignas(T) unsigned char storage[sizeof(T)]; ///< The storage for the item
+
+        T* get() {
+            return std::launder(reinterpret_cast<T*>(storage));
+        }
+    };
+
+    using cell_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<cell>;
+
+public:
+    /*!
+     * \brief Construct a ring buffer.
+     * \param capacity The minimum capacity of the ring buffer
+     * \param alloc The allocator to use
+     */
+    explicit mpsc_ring_buffer(std::size_t capacity = default_capacity, const Allocator& alloc = Allocator())
+            : allocator(alloc), mask(std::bit_ceil(capacity < 2 ? std::size_t(2) : capacity) - 1) {
+        cells = std::allocator_traits<cell_allocator>::allocate(allocator, mask + 1);
+
+        for (std::size_t i = 0; i <= mask; ++i) {
+            ::new (static_cast<void*>(&cells[i].sequence)) std::atomic<std::size_t>(i);
+        }
+    }
+
+    mpsc_ring_buffer(const mpsc_ring_buffer& rhs) = delete;
+    mpsc_ring_buffer& operator=(const mpsc_ring_buffer& rhs) = delete;
+
+    /*!
+     * \brief Destroy the remaining items and release the storage
+     */
+    ~mpsc_ring_buffer() {
+        T* value;
+        while ((value = peek())) {
+            std::destroy_at(value);
+            advance();
+        }
+
+        std::allocator_traits<cell_allocator>::deallocate(allocator, cells, mask + 1);
+    }
+
+    /*!
+     * \brief Returns the number of items the ring buffer can hold
+     */
+    std::size_t capacity() const noexcept {
+        return mask + 1;
+    }
+
+    /*!
+     * \brief Returns the number of items currently in the ring buffer.
+     *
+     * Items that are being written by producers are counted as well. The
+     * value is only a snapshot when producers are active.
+     */
+    std::size_t size() const noexcept {
+        auto h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+    /*!
+     * \brief Indicates if the ring buffer is currently empty
+     */
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Producer side (thread-safe)
+
+    /*!
+     * \brief Try to construct a new item at the end of the ring buffer.
+     * \return true if the item was inserted, false if the ring buffer was full
+     */
+    template <typename... Args>
+    bool try_emplace(Args&&... args) {
+        auto pos = tail.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto& c   = cells[pos & mask];
+            auto diff = static_cast<std::intptr_t>(c.sequence.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        auto& c = cells[pos & mask];
+        ::new (static_cast<void*>(c.storage)) T(std::forward<Args>(args)...);
+        c.sequence.store(pos + 1, std::memory_order_release);
+
+        notify(not_empty);
+
+        return true;
+    }
+
+    /*!
+     * \brief Try to push the given item at the end of the ring buffer.
+     * \return true if the item was inserted, false if the ring buffer was full
+     */
+    bool try_push(const T& value) {
+        return try_emplace(value);
+    }
+
+    /*!
+     * \copydoc try_push
+     */
+    bool try_push(T&& value) {
+        return try_emplace(std::move(value));
+    }
+
+    /*!
+     * \brief Push as many items as possible from the given range.
+     *
+     * The pushed items are contiguous in the ring buffer, they are not
+     * interleaved with the items of other producers.
+     *
+     * \param first The beginning of the items to push
+     * \param n The number of items to push
+     * \return The number of items that have been pushed
+     */
+    template <typename Iterator>
+    std::size_t try_push_n(Iterator first, std::size_t n) {
+        if (!n) {
+            return 0;
+        }
+
+        auto pos = tail.load(std::memory_order_relaxed);
+        auto k   = std::min(n, capacity());
+
+        while (true) {
+            // The single consumer frees the slots in order, if the last slot is free, all are free
+            auto last = pos + k - 1;
+            auto diff = static_cast<std::intptr_t>(cells[last & mask].sequence.load(std::memory_order_acquire) - last);
+
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                auto h    = head.load(std::memory_order_acquire);
+                auto free = pos - h < capacity() ? capacity() - (pos - h) : 0;
+
+                if (!free) {
+                    return 0;
+                }
+
+                k   = std::min(k, free);
+                pos = tail.load(std::memory_order_relaxed);
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        for (std::size_t i = 0; i < k; ++i, ++first) {
+            auto& c = cells[(pos + i) & mask];
+            ::new (static_cast<void*>(c.storage)) T(*first);
+            c.sequence.store(pos + i + 1, std::memory_order_release);
+        }
+
+        notify(not_empty);
+
+        return k;
+    }
+
+    /*!
+     * \brief Push the given item, waiting for room if necessary
+     */
+    template <typename... Args>
+    void push(Args&&... args) {
+        while (!try_emplace(std::forward<Args>(args)...)) {
+            ring_buffer_detail::wait_until<Wait>(not_full, [this] { return size() < capacity(); });
+        }
+    }
+
+    // Consumer side (single thread)
+
+    /*!
+     * \brief Try to pop the first item of the ring buffer.
+     * \param value The variable receiving the item
+     * \return true if an item was popped, false if the ring buffer was empty
+     */
+    bool try_pop(T& value) {
+        if (auto* item = peek()) {
+            value = std::move(*item);
+            std::destroy_at(item);
+            advance();
+            notify(not_full);
+            return true;
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Pop as many items as possible, up to n.
+     * \param out The output iterator receiving the items
+     * \param n The maximum number of items to pop
+     * \return The number of items that have been popped
+     */
+    template <typename OutputIterator>
+    std::size_t try_pop_n(OutputIterator out, std::size_t n) {
+        std::size_t k = 0;
+
+        for (T* item; k < n && (item = peek()); ++k, ++out) {
+            *out = std::move(*item);
+            std::destroy_at(item);
+            advance();
+        }
+
+        if (k) {
+            notify(not_full);
+        }
+
+        return k;
+    }
+
+    /*!
+     * \brief Pop the first item, waiting for one if necessary
+     */
+    T pop() {
+        ring_buffer_detail::wait_until<Wait>(not_empty, [this] { return peek() != nullptr; });
+
+        T value(std::move(front()));
+        pop_front();
+        return value;
+    }
+
+    // queue_t interface
+
+    /*!
+     * \brief Returns a reference to the first item.
+     *
+     * The first item must have been completely pushed.
+     */
+    T& front() {
+        auto* item = peek();
+        cpp_assert(item, "front() on empty ring buffer");
+        return *item;
+    }
+
+    /*!
+     * \brief Remove the first item.
+     *
+     * The first item must have been completely pushed.
+     */
+    void pop_front() {
+        auto* item = peek();
+        cpp_assert(item, "pop_front() on empty ring buffer");
+        std::destroy_at(item);
+        advance();
+        notify(not_full);
+    }
+
+    /*!
+     * \brief Construct a new item at the end of the ring buffer, throws if it is full.
+     */
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        if (!try_emplace(std::forward<Args>(args)...)) {
+            ring_buffer_detail::full_error();
+        }
+    }
+
+    /*!
+     * \brief Push a new item at the end of the ring buffer, throws if it is full.
+     */
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    /*!
+     * \copydoc push_back
+     */
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+private:
+    /*!
+     * \brief Returns a pointer to the first item if it has been published, nullptr otherwise
+     */
+    T* peek() {
+        const auto h = head.load(std::memory_order_relaxed);
+        auto& c      = cells[h & mask];
+
+        if (c.sequence.load(std::memory_order_acquire) != h + 1) {
+            return nullptr;
+        }
+
+        return c.get();
+    }
+
+    /*!
+     * \brief Release the first slot for the next lap of the producers
+     */
+    void advance() {
+        const auto h = head.load(std::memory_order_relaxed);
+        cells[h & mask].sequence.store(h + mask + 1, std::memory_order_release);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    static void notify(event_count& event) {
+        if constexpr (std::is_same_v<Wait, wait_futex>) {
+            event.notify_one();
+        } else {
+            cpp_unused(event);
+        }
+    }
+
+    // Read-only after construction
+    alignas(cache_line_size) cell_allocator allocator; ///< The allocator
+    const std::size_t mask;                            ///< capacity - 1
+    cell* cells = nullptr;                             ///< The storage
+
+    alignas(cache_line_size) std::atomic<std::size_t> tail{0}; ///< The next position to claim by producers
+    alignas(cache_line_size) std::atomic<std::size_t> head{0}; ///< The next position to read
+
+    alignas(cache_line_size) event_count not_empty; ///< Notified when items are pushed
+    alignas(cache_line_size) event_count not_full;  ///< Notified when items are popped
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_RING_BUFFER_HPP
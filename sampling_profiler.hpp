@@ -0,0 +1,467 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file sampling_profiler.hpp
+ * \brief Contains an in-process sampling profiler writing collapsed stacks.
+ *
+ * \code
+ * cpp::sampling_profiler profiler(std::chrono::milliseconds(1));
+ *
+ * {
+ *     cpp::auto_stop_watch<> watch("load");
+ *     load();
+ * }
+ *
+ * profiler.stop();
+ *
+ * std::ofstream out("profile.folded");
+ * profiler.write_collapsed(out);
+ * \endcode
+ *
+ * The output can be given to flamegraph.pl. Each stack starts with the
+ * title of the innermost auto_stop_watch alive when it was sampled.
+ *
+ * The stacks are unwound with the frame pointers, the profiled code must
+ * be compiled with -fno-omit-frame-pointer for complete stacks. The
+ * symbols are resolved with dladdr, the executable should be linked with
+ * -rdynamic for its own functions to be named. Only Linux on x86_64 and
+ * aarch64 is supported, elsewhere no sample is recorded.
+ */
+
+#ifndef CPP_UTILS_SAMPLING_PROFILER_HPP
+#define CPP_UTILS_SAMPLING_PROFILER_HPP
+
+#ifdef CPP_UTILS_NO_EXCEPT
+#include <iostream>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#endif
+
+#include "assert.hpp"
+#include "stop_watch.hpp"
+
+namespace cpp {
+
+namespace sampling_detail {
+
+constexpr std::size_t max_depth      = 64;        ///< The maximum number of frames of a sample
+constexpr std::size_t section_length = 64;        ///< The maximum length (with the terminator) of a section name
+constexpr std::uintptr_t max_frame   = 1 << 20;   ///< The maximum size of a stack frame, to detect invalid frame pointers
+constexpr std::size_t max_probes     = 64;        ///< The maximum number of probes to find the entry of a stack
+
+/*!
+ * \brief A distinct stack (and section) and its number of samples
+ */
+struct entry {
+    std::atomic<uint64_t> hash{0};    ///< The hash of the stack, 0 for an empty entry
+    std::atomic<uint64_t> count{0};   ///< The number of samples
+    std::atomic<bool> ready{false};   ///< Indicates if the stack has been written
+    std::size_t depth = 0;            ///< The number of frames
+    void* frames[max_depth];          ///< The frames, from the leaf
+    char section[section_length];     ///< The section of the samples
+};
+
+/*!
+ * \brief The lock-free hash table aggregating the samples by stack.
+ *
+ * An entry is claimed by the first sample of its stack, with a CAS on its
+ * hash, and the next samples of the same stack only increment its count.
+ * Nothing is allocated in the signal handler.
+ */
+struct table {
+    /*!
+     * \brief Construct a table of the given capacity (a power of two)
+     */
+    explicit table(std::size_t capacity) : entries(std::make_unique<entry[]>(capacity)), capacity(capacity) {}
+
+    std::unique_ptr<entry[]> entries;   ///< The entries
+    const std::size_t capacity;         ///< The number of entries
+    std::atomic<uint64_t> samples{0};   ///< The number of recorded samples
+    std::atomic<uint64_t> dropped{0};   ///< The number of samples dropped because the table is full
+};
+
+inline std::atomic<table*> active{nullptr}; ///< The table of the running profiler
+inline std::atomic<int> handlers{0};        ///< The number of signal handlers currently running
+
+/*!
+ * \brief Add the given stack to the table
+ */
+inline void insert(table& t, void** frames, std::size_t depth, const char* section) {
+    // FNV-1a of the frames and of the section
+    uint64_t hash = 14695981039346656037ULL;
+
+    auto mix = [&hash](uint64_t value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+
+    for (std::size_t i = 0; i < depth; ++i) {
+        mix(reinterpret_cast<uintptr_t>(frames[i]));
+    }
+
+    for (std::size_t i = 0; section[i]; ++i) {
+        mix(static_cast<unsigned char>(section[i]));
+    }
+
+    hash = hash ? hash : 1;
+
+    for (std::size_t probe = 0; probe < max_probes && probe < t.capacity; ++probe) {
+        auto& e = t.entries[(hash + probe) & (t.capacity - 1)];
+
+        uint64_t current = e.hash.load(std::memory_order_acquire);
+
+        if (!current && e.hash.compare_exchange_strong(current, hash, std::memory_order_acq_rel)) {
+            e.depth = depth;
+
+            for (std::size_t i = 0; i < depth; ++i) {
+                e.frames[i] = frames[i];
+            }
+
+            for (std::size_t i = 0; i < section_length; ++i) {
+                e.section[i] = section[i];
+            }
+
+            e.ready.store(true, std::memory_order_release);
+            e.count.fetch_add(1, std::memory_order_relaxed);
+            t.samples.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (current == hash) {
+            e.count.fetch_add(1, std::memory_order_relaxed);
+            t.samples.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    t.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+#ifdef __linux__
+
+/*!
+ * \brief Record the stack of the interrupted thread, described by the
+ * given signal context. Only async-signal-safe operations are used.
+ */
+inline void record(table& t, void* context) {
+    void* frames[max_depth];
+    std::size_t depth = 0;
+
+    uintptr_t pc;
+    uintptr_t sp;
+    uintptr_t fp;
+
+    const auto* uc = static_cast<const ucontext_t*>(context);
+
+#if defined(__x86_64__)
+    pc = uc->uc_mcontext.gregs[REG_RIP];
+    sp = uc->uc_mcontext.gregs[REG_RSP];
+    fp = uc->uc_mcontext.gregs[REG_RBP];
+#elif defined(__aarch64__)
+    pc = uc->uc_mcontext.pc;
+    sp = uc->uc_mcontext.sp;
+    fp = uc->uc_mcontext.regs[29];
+#else
+    (void)uc;
+    t.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+#endif
+
+    frames[depth++] = reinterpret_cast<void*>(pc);
+
+    // Each frame starts with the previous frame pointer and the return address
+    uintptr_t low = sp;
+
+    while (depth < max_depth && fp >= low && fp - low < max_frame && !(fp % sizeof(uintptr_t))) {
+        const auto* frame = reinterpret_cast<const uintptr_t*>(fp);
+
+        if (!frame[1]) {
+            break;
+        }
+
+        frames[depth++] = reinterpret_cast<void*>(frame[1]);
+
+        low = fp + 2 * sizeof(uintptr_t);
+        fp  = frame[0];
+    }
+
+    char section[section_length] = {};
+
+    if (const char* name = current_section()) {
+        for (std::size_t i = 0; i + 1 < section_length && name[i]; ++i) {
+            section[i] = name[i];
+        }
+    }
+
+    insert(t, frames, depth, section);
+}
+
+/*!
+ * \brief The SIGPROF handler
+ */
+inline void handler(int /*signal*/, siginfo_t* /*info*/, void* context) {
+    handlers.fetch_add(1);
+
+    if (auto* t = active.load()) {
+        record(*t, context);
+    }
+
+    handlers.fetch_sub(1);
+}
+
+#endif
+
+/*!
+ * \brief Returns the name of the function containing the given address
+ */
+inline std::string symbolize(void* address) {
+    std::ostringstream name;
+
+#ifdef __linux__
+    Dl_info info;
+
+    if (dladdr(address, &info)) {
+        if (info.dli_sname) {
+            int status     = 0;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+
+            std::string symbol = status == 0 && demangled ? demangled : info.dli_sname;
+
+            std::free(demangled);
+
+            return symbol;
+        }
+
+        if (info.dli_fname) {
+            std::string module = info.dli_fname;
+            module = module.substr(module.rfind('/') + 1);
+
+            name << module << "+0x" << std::hex << (reinterpret_cast<uintptr_t>(address) - reinterpret_cast<uintptr_t>(info.dli_fbase));
+
+            return name.str();
+        }
+    }
+#endif
+
+    name << "0x" << std::hex << reinterpret_cast<uintptr_t>(address);
+
+    return name.str();
+}
+
+} //end of namespace sampling_detail
+
+/*!
+ * \brief An in-process sampling profiler.
+ *
+ * The process is interrupted by SIGPROF, through an ITIMER_PROF timer, at
+ * the given interval of CPU time and the stack of the interrupted thread
+ * is recorded. The samples are aggregated by stack and by section (see
+ * current_section()) in a fixed-size lock-free table, nothing is
+ * allocated while sampling. The profile is written as collapsed stacks,
+ * for flame graphs.
+ *
+ * Only one profiler can run at a time in the process.
+ */
+struct sampling_profiler {
+    /*!
+     * \brief Construct a profiler and start it
+     * \param interval The interval between two samples, in CPU time
+     * \param capacity The maximum number of distinct stacks (rounded up to a power of two)
+     */
+    explicit sampling_profiler(std::chrono::microseconds interval = std::chrono::milliseconds(1), std::size_t capacity = 4096)
+            : interval(interval), samples_table(std::make_unique<sampling_detail::table>(std::bit_ceil(std::max(capacity, std::size_t(2))))) {
+        start();
+    }
+
+    sampling_profiler(const sampling_profiler& rhs) = delete;
+    sampling_profiler& operator=(const sampling_profiler& rhs) = delete;
+
+    /*!
+     * \brief Stop the profiler
+     */
+    ~sampling_profiler() {
+        stop();
+    }
+
+    /*!
+     * \brief Start, or restart, sampling. The samples are added to the previous ones.
+     */
+    void start() {
+        if (running) {
+            return;
+        }
+
+        sampling_detail::table* expected = nullptr;
+
+        if (!sampling_detail::active.compare_exchange_strong(expected, samples_table.get())) {
+#ifndef CPP_UTILS_NO_EXCEPT
+            throw std::logic_error("cpp_utils: a sampling_profiler is already running");
+#else
+            std::cerr << "cpp_utils: a sampling_profiler is already running (exceptions disabled)" << std::endl;
+            std::abort();
+#endif
+        }
+
+        running = true;
+
+#ifdef __linux__
+        struct sigaction action = {};
+        action.sa_sigaction = sampling_detail::handler;
+        action.sa_flags     = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, &previous_action);
+
+        const auto us = std::max<long long>(1, interval.count());
+
+        itimerval timer;
+        timer.it_interval.tv_sec  = us / 1000000;
+        timer.it_interval.tv_usec = us % 1000000;
+        timer.it_value            = timer.it_interval;
+        setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+    }
+
+    /*!
+     * \brief Stop sampling. The recorded samples are kept.
+     */
+    void stop() {
+        if (!running) {
+            return;
+        }
+
+#ifdef __linux__
+        itimerval timer = {};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+
+        sampling_detail::active.store(nullptr);
+
+        // Wait for the handlers still using the table
+        while (sampling_detail::handlers.load()) {
+            std::this_thread::yield();
+        }
+
+#ifdef __linux__
+        // A SIGPROF may still be pending. The default action would kill
+        // the process, the handler is left installed instead, it does
+        // nothing once the profiler is stopped. A handler of the
+        // application is restored since it can handle it.
+        const bool previous_default = !(previous_action.sa_flags & SA_SIGINFO) && previous_action.sa_handler == SIG_DFL;
+
+        if (!previous_default) {
+            sigaction(SIGPROF, &previous_action, nullptr);
+        }
+#endif
+
+        running = false;
+    }
+
+    /*!
+     * \brief Returns the number of recorded samples
+     */
+    std::size_t samples() const {
+        return samples_table->samples.load();
+    }
+
+    /*!
+     * \brief Returns the number of samples dropped because there were too many distinct stacks
+     */
+    std::size_t dropped() const {
+        return samples_table->dropped.load();
+    }
+
+    /*!
+     * \brief Write the profile as collapsed stacks: one line per stack, the
+     * section and the functions from the root to the leaf separated by
+     * semicolons, followed by the number of samples.
+     *
+     * The stacks that are identical once symbolized are merged. This should
+     * be called once the profiler is stopped.
+     *
+     * \param out The stream to write to
+     */
+    void write_collapsed(std::ostream& out) const {
+        std::map<void*, std::string> symbols;
+        std::map<std::string, uint64_t> stacks;
+
+        for (std::size_t i = 0; i < samples_table->capacity; ++i) {
+            auto& e = samples_table->entries[i];
+
+            if (!e.ready.load(std::memory_order_acquire)) {
+                continue;
+            }
+
+            std::string stack = e.section[0] ? e.section : "";
+
+            for (std::size_t f = e.depth; f-- > 0;) {
+                // The return addresses point after the call instruction
+                auto* address = static_cast<char*>(e.frames[f]) - (f ? 1 : 0);
+
+                auto it = symbols.find(address);
+
+                if (it == symbols.end()) {
+                    it = symbols.emplace(address, sampling_detail::symbolize(address)).first;
+                }
+
+                if (!stack.empty()) {
+                    stack += ';';
+                }
+
+                stack += it->second;
+            }
+
+            stacks[stack] += e.count.load();
+        }
+
+        for (auto& [stack, count] : stacks) {
+            out << stack << ' ' << count << '\n';
+        }
+    }
+
+    /*!
+     * \brief Discard the recorded samples. The profiler must be stopped.
+     */
+    void clear() {
+        cpp_assert(!running, "sampling_profiler: clear() on a running profiler");
+
+        samples_table = std::make_unique<sampling_detail::table>(samples_table->capacity);
+    }
+
+private:
+    const std::chrono::microseconds interval;                ///< The interval between two samples
+    std::unique_ptr<sampling_detail::table> samples_table;   ///< The aggregated samples
+    bool running = false;                                    ///< Indicates if the profiler is sampling
+
+#ifdef __linux__
+    struct sigaction previous_action = {}; ///< The SIGPROF action before the profiler started
+#endif
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_SAMPLING_PROFILER_HPP
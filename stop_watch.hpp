@@ -23,6 +23,26 @@ namespace cpp {
  */
 using clock_type = std::chrono::high_resolution_clock;
 
+namespace stop_watch_detail {
+
+/*!
+ * \brief The title of the innermost auto_stop_watch of the current thread
+ */
+inline thread_local const char* current_section = nullptr;
+
+} //end of namespace stop_watch_detail
+
+/*!
+ * \brief Returns the title of the innermost auto_stop_watch of the current
+ * thread, nullptr if there is none.
+ *
+ * This is used to attribute the samples of the sampling profiler to the
+ * measured sections.
+ */
+inline const char* current_section() {
+    return stop_watch_detail::current_section;
+}
+
 /*!
  * \class stop_watch
  * \brief A stop watch
@@ -64,6 +84,7 @@ private:
  * \tparam P The std::chrono precision used by the watch.
  *
  * The watch automatically starts when the constructor is called and display the duration when destructed.
+ * While it is alive, its title is the current section of the thread (see current_section()).
  */
 template <typename P = std::chrono::milliseconds>
 struct auto_stop_watch {
@@ -77,19 +98,28 @@ struct auto_stop_watch {
      * \param title The title that will be displayed when the watch is over.
      */
     explicit auto_stop_watch(std::string title)
-            : title(std::move(title)) {
-        //Empty
+            : title(std::move(title)), previous_section(stop_watch_detail::current_section) {
+        stop_watch_detail::current_section = this->title.c_str();
     }
 
+    // The title is published as the current section, the watch cannot be copied or moved
+    auto_stop_watch(const auto_stop_watch& rhs) = delete;
+    auto_stop_watch(auto_stop_watch&& rhs) = delete;
+    auto_stop_watch& operator=(const auto_stop_watch& rhs) = delete;
+    auto_stop_watch& operator=(auto_stop_watch&& rhs) = delete;
+
     /*!
      * \brief Destroys the auto_stop_watch and display the elapsed time.
      */
     ~auto_stop_watch() {
+        stop_watch_detail::current_section = previous_section;
+
         std::cout << title << " took " << watch.elapsed() << std::endl;
     }
 
 private:
     std::string title;
+    const char* previous_section;
     stop_watch<precision> watch;
 };
 
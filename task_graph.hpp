@@ -0,0 +1,260 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file task_graph.hpp
+ * \brief Contains a graph of tasks with dependencies, executed on a thread pool.
+ *
+ * \code
+ * cpp::task_graph graph;
+ * auto a = graph.add([] { load(); });
+ * auto b = graph.add([] { parse(); });
+ * auto c = graph.add([] { link(); });
+ * graph.precede(a, c);
+ * graph.precede(b, c);
+ *
+ * graph.run(pool); // a and b run concurrently, then c
+ * \endcode
+ */
+
+#ifndef CPP_UTILS_TASK_GRAPH_HPP
+#define CPP_UTILS_TASK_GRAPH_HPP
+
+#ifdef CPP_UTILS_NO_EXCEPT
+#include <iostream>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "assert.hpp"
+#include "thread_pool.hpp"
+
+namespace cpp {
+
+/*!
+ * \brief A directed acyclic graph of tasks.
+ *
+ * The graph is built once and can then be run many times. Each node keeps
+ * an atomic count of its unfinished predecessors, reset at the beginning
+ * of each run. When a task is done, the counts of its successors are
+ * decremented and the successors reaching zero are ready: the first one
+ * is executed directly by the same thread, as a continuation, and the
+ * others are submitted to the thread pool. A run does not allocate,
+ * except for the submission of the tasks to the thread pool.
+ *
+ * The first exception thrown by a task is rethrown by run() once the run
+ * is done. The tasks not yet started are then skipped, but the run still
+ * goes through all the nodes.
+ *
+ * The same graph must not be run concurrently, nor modified while running.
+ */
+struct task_graph {
+    using node_id = std::size_t; ///< The identifier of a node
+
+    /*!
+     * \brief Add a task to the graph
+     * \param fun The task
+     * \return The identifier of the new node
+     */
+    template <typename Functor>
+    node_id add(Functor fun) {
+        nodes.push_back({std::function<void()>(std::move(fun)), {}, 0});
+        dirty = true;
+        return nodes.size() - 1;
+    }
+
+    /*!
+     * \brief Add a dependency: before must be done before after starts
+     * \param before The node to run first
+     * \param after The node depending on before
+     */
+    void precede(node_id before, node_id after) {
+        cpp_assert(before < nodes.size() && after < nodes.size(), "task_graph: invalid node");
+
+        nodes[before].successors.push_back(after);
+        ++nodes[after].predecessors;
+        dirty = true;
+    }
+
+    /*!
+     * \brief Returns the number of nodes of the graph
+     */
+    std::size_t size() const {
+        return nodes.size();
+    }
+
+    /*!
+     * \brief Run all the tasks of the graph on the given thread pool,
+     * respecting the dependencies, and wait for them to be done.
+     *
+     * The graph is validated the first time it is run after being
+     * modified. Running a graph with a cycle is an error.
+     *
+     * \param thread_pool The thread pool responsible for scheduling the jobs.
+     */
+    template <typename TP>
+    void run(TP& thread_pool) {
+        if (nodes.empty()) {
+            return;
+        }
+
+        if (dirty) {
+            prepare();
+        }
+
+        for (std::size_t n = 0; n < nodes.size(); ++n) {
+            remaining[n].store(nodes[n].predecessors, std::memory_order_relaxed);
+        }
+
+        unfinished.store(nodes.size(), std::memory_order_relaxed);
+        cancelled.store(false, std::memory_order_relaxed);
+        finished = false;
+        error    = nullptr;
+
+        for (auto source : sources) {
+            thread_pool_detail::do_task_or_run(thread_pool, [this, &thread_pool, source] { execute(thread_pool, source); });
+        }
+
+        std::unique_lock<std::mutex> l(lock);
+        done.wait(l, [this] { return finished; });
+
+#ifndef CPP_UTILS_NO_EXCEPT
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+#endif
+    }
+
+private:
+    static constexpr node_id npos = node_id(-1); ///< No node
+
+    /*!
+     * \brief A node of the graph
+     */
+    struct node {
+        std::function<void()> task;     ///< The task
+        std::vector<node_id> successors; ///< The nodes depending on this node
+        std::size_t predecessors;        ///< The number of nodes this node depends on
+    };
+
+    /*!
+     * \brief Allocate the counters, find the sources and check that the graph has no cycle
+     */
+    void prepare() {
+        remaining = std::make_unique<std::atomic<std::size_t>[]>(nodes.size());
+
+        sources.clear();
+        for (node_id n = 0; n < nodes.size(); ++n) {
+            if (!nodes[n].predecessors) {
+                sources.push_back(n);
+            }
+        }
+
+        // Topological traversal (Kahn), every node must be reached
+        std::vector<std::size_t> counts(nodes.size());
+        for (node_id n = 0; n < nodes.size(); ++n) {
+            counts[n] = nodes[n].predecessors;
+        }
+
+        std::vector<node_id> ready(sources);
+        std::size_t reached = 0;
+
+        while (!ready.empty()) {
+            const auto n = ready.back();
+            ready.pop_back();
+            ++reached;
+
+            for (auto s : nodes[n].successors) {
+                if (--counts[s] == 0) {
+                    ready.push_back(s);
+                }
+            }
+        }
+
+        if (reached != nodes.size()) {
+#ifndef CPP_UTILS_NO_EXCEPT
+            throw std::logic_error("cpp_utils: task_graph contains a cycle");
+#else
+            std::cerr << "cpp_utils: task_graph contains a cycle (exceptions disabled)" << std::endl;
+            std::abort();
+#endif
+        }
+
+        dirty = false;
+    }
+
+    /*!
+     * \brief Execute the given node and, as continuations, its ready successors
+     */
+    template <typename TP>
+    void execute(TP& thread_pool, node_id n) {
+        while (n != npos) {
+#ifndef CPP_UTILS_NO_EXCEPT
+            if (!cancelled.load(std::memory_order_relaxed)) {
+                try {
+                    nodes[n].task();
+                } catch (...) {
+                    std::unique_lock<std::mutex> l(lock);
+
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+
+                    cancelled.store(true, std::memory_order_relaxed);
+                }
+            }
+#else
+            nodes[n].task();
+#endif
+
+            node_id next = npos;
+
+            for (auto s : nodes[n].successors) {
+                if (remaining[s].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next == npos) {
+                        next = s;
+                    } else {
+                        thread_pool_detail::do_task_or_run(thread_pool, [this, &thread_pool, s] { execute(thread_pool, s); });
+                    }
+                }
+            }
+
+            if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                // Notify under the lock, run() cannot return before the notification is done
+                std::unique_lock<std::mutex> l(lock);
+                finished = true;
+                done.notify_all();
+            }
+
+            n = next;
+        }
+    }
+
+    std::vector<node> nodes;                              ///< The nodes of the graph
+    std::vector<node_id> sources;                         ///< The nodes without predecessors
+    std::unique_ptr<std::atomic<std::size_t>[]> remaining; ///< The number of unfinished predecessors of each node
+    std::atomic<std::size_t> unfinished{0};               ///< The number of unfinished nodes of the run
+    std::atomic<bool> cancelled{false};                   ///< Indicates if a task of the run has thrown
+    bool dirty = true;                                    ///< Indicates if the graph changed since the last run
+
+    std::mutex lock;              ///< The lock protecting finished and error
+    std::condition_variable done; ///< Notified at the end of the run
+    bool finished = false;        ///< Indicates if the run is done
+    std::exception_ptr error;     ///< The first exception thrown by a task of the run
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_TASK_GRAPH_HPP
@@ -0,0 +1,293 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file task_group.hpp
+ * \brief Contains a fork-join API (spawn/sync) on top of the thread pools.
+ *
+ * A task can spawn sub-tasks and then wait for them, recursively, which is
+ * not possible with wait() on the thread pool itself:
+ *
+ * \code
+ * void sort(TP& pool, It first, It last) {
+ *     auto middle = partition(first, last);
+ *     cpp::parallel_invoke(pool,
+ *         [&] { sort(pool, first, middle); },
+ *         [&] { sort(pool, middle, last); });
+ * }
+ * \endcode
+ */
+
+#ifndef CPP_UTILS_TASK_GROUP_HPP
+#define CPP_UTILS_TASK_GROUP_HPP
+
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace cpp {
+
+namespace task_group_detail {
+
+/*!
+ * \brief The number of spawn levels allowed beyond log2(threads).
+ *
+ * Deeper spawns are executed inline, which bounds both the number of
+ * tasks in flight and the stack depth while leaving enough tasks to
+ * balance the load.
+ */
+constexpr std::size_t extra_depth = 4;
+
+/*!
+ * \brief The spawn depth of the task currently running on this thread
+ */
+inline thread_local std::size_t depth = 0;
+
+/*!
+ * \brief Set the spawn depth of the current thread for the lifetime of the scope
+ */
+struct depth_scope {
+    /*!
+     * \brief Set the spawn depth to the given depth
+     */
+    explicit depth_scope(std::size_t new_depth) : saved(task_group_detail::depth) {
+        task_group_detail::depth = new_depth;
+    }
+
+    depth_scope(const depth_scope& rhs) = delete;
+    depth_scope& operator=(const depth_scope& rhs) = delete;
+
+    /*!
+     * \brief Restore the previous spawn depth
+     */
+    ~depth_scope() {
+        task_group_detail::depth = saved;
+    }
+
+private:
+    const std::size_t saved; ///< The previous spawn depth
+};
+
+/*!
+ * \brief A spawned task, claimed exactly once either by a thread of the
+ * pool or by the thread syncing its group.
+ */
+struct node {
+    std::function<void()> fun;      ///< The task
+    std::size_t depth;              ///< The spawn depth of the task
+    std::atomic<bool> claimed{false}; ///< Indicates if a thread has claimed the task
+
+    /*!
+     * \brief Claim the task
+     * \return true if the task was claimed by this call, false otherwise
+     */
+    bool claim() {
+        return !claimed.load(std::memory_order_relaxed) && !claimed.exchange(true, std::memory_order_acquire);
+    }
+
+    /*!
+     * \brief Run the task at its depth
+     */
+    void run() {
+        depth_scope scope(depth);
+        fun();
+    }
+};
+
+} //end of namespace task_group_detail
+
+/*!
+ * \brief A group of tasks spawned on a thread pool and synchronized together.
+ *
+ * Each spawned task is submitted to the thread pool. When the group is
+ * synchronized, the tasks not yet started by the pool are executed inline
+ * by the waiting thread (help-first), from the most recently spawned one.
+ * The waiting thread only executes the tasks of its own group, which
+ * keeps the waits nested like the recursion and cannot deadlock, even when
+ * all the threads of the pool are waiting. The tasks spawned too deep in
+ * the recursion are directly executed inline.
+ *
+ * The first exception thrown by a task is rethrown by sync(), once all
+ * the tasks are done. The tasks not yet started at this point are
+ * cancelled.
+ *
+ * spawn() and sync() must be called by the thread owning the group.
+ *
+ * \tparam TP The type of thread pool
+ */
+template <typename TP>
+struct task_group {
+    /*!
+     * \brief Construct a task group spawning its tasks on the given thread pool
+     */
+    explicit task_group(TP& thread_pool)
+            : pool(thread_pool), max_depth(std::bit_width(thread_pool.size()) + task_group_detail::extra_depth) {
+        //Nothing else to init
+    }
+
+    task_group(const task_group& rhs) = delete;
+    task_group& operator=(const task_group& rhs) = delete;
+
+    /*!
+     * \brief Wait for all the spawned tasks. Their exceptions are not rethrown.
+     */
+    ~task_group() {
+        join();
+    }
+
+    /*!
+     * \brief Spawn the given functor as a task of the group
+     * \param fun The functor to execute
+     */
+    template <typename Functor>
+    void spawn(Functor fun) {
+        const std::size_t depth = task_group_detail::depth + 1;
+
+        if (depth > max_depth) {
+            task_group_detail::depth_scope scope(depth);
+            fun();
+            return;
+        }
+
+        auto task = std::make_shared<task_group_detail::node>();
+        task->fun   = std::move(fun);
+        task->depth = depth;
+
+        {
+            std::unique_lock<std::mutex> l(lock);
+            ++pending;
+        }
+
+        tasks.push_back(task);
+
+        // The thread pool only runs the task if the syncing thread did not run it
+        thread_pool_detail::do_task_or_run(pool, [this, task] {
+            if (task->claim()) {
+                execute(*task);
+            }
+        });
+    }
+
+    /*!
+     * \brief Wait for all the spawned tasks to be done, executing the ones
+     * not yet started by the thread pool, and rethrow the first exception
+     * thrown by a task, if any.
+     */
+    void sync() {
+        join();
+
+#ifndef CPP_UTILS_NO_EXCEPT
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+#endif
+    }
+
+private:
+    /*!
+     * \brief Wait for all the spawned tasks to be done, executing the ones
+     * not yet started by the thread pool.
+     */
+    void join() {
+        while (!tasks.empty()) {
+            auto task = std::move(tasks.back());
+            tasks.pop_back();
+
+            if (task->claim()) {
+                execute(*task);
+            }
+        }
+
+        std::unique_lock<std::mutex> l(lock);
+        finished.wait(l, [this] { return pending == 0; });
+    }
+
+    /*!
+     * \brief Execute the given claimed task, unless the group is cancelled,
+     * and capture its exception.
+     */
+    void execute(task_group_detail::node& task) {
+#ifndef CPP_UTILS_NO_EXCEPT
+        if (!cancelled.load(std::memory_order_relaxed)) {
+            try {
+                task.run();
+            } catch (...) {
+                std::unique_lock<std::mutex> l(lock);
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+
+                cancelled.store(true, std::memory_order_relaxed);
+            }
+        }
+#else
+        task.run();
+#endif
+
+        done();
+    }
+
+    /*!
+     * \brief Mark one task as done.
+     *
+     * The counter is decremented under the lock so that the group cannot
+     * be destroyed by sync() while the condition is notified.
+     */
+    void done() {
+        std::unique_lock<std::mutex> l(lock);
+
+        if (--pending == 0) {
+            finished.notify_all();
+        }
+    }
+
+    TP& pool;                                                    ///< The thread pool
+    const std::size_t max_depth;                                 ///< The maximum spawn depth
+    std::vector<std::shared_ptr<task_group_detail::node>> tasks; ///< The tasks not yet synchronized
+    std::mutex lock;                                             ///< The lock protecting the counter
+    std::condition_variable finished;                            ///< Notified when all the tasks are done
+    std::size_t pending = 0;                                     ///< The number of tasks not done
+    std::exception_ptr error;                                    ///< The first exception thrown by a task
+    std::atomic<bool> cancelled{false};                          ///< Indicates if a task has thrown
+};
+
+/*!
+ * \brief Execute, concurrently, all the given functors and wait for them.
+ *
+ * The first functor is executed by the calling thread, the other ones are
+ * spawned in a task_group. This can be called recursively from the tasks
+ * themselves. The first exception thrown by a functor is rethrown once
+ * all the functors are done (an exception of the first functor is
+ * propagated as soon as the other ones are done).
+ *
+ * \param thread_pool The thread pool responsible for scheduling the jobs.
+ * \param first The first functor
+ * \param functors The other functors
+ */
+template <typename TP, typename Functor, typename... Functors>
+void parallel_invoke(TP& thread_pool, Functor&& first, Functors&&... functors) {
+    task_group<TP> group(thread_pool);
+
+    (group.spawn(std::forward<Functors>(functors)), ...);
+
+    first();
+
+    group.sync();
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_TASK_GROUP_HPP
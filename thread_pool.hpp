@@ -16,17 +16,92 @@
 #endif
 
 #include <thread>
+#include <condition_variable>
 #include <future>
+#include <mutex>
 #include <vector>
 #include <deque>
 #include <functional>
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
 
 #include "assert.hpp"
 #include "tmp.hpp"
 
 namespace cpp {
 
+/*!
+ * \brief The behaviour of a thread pool when its queue is full
+ */
+enum class overflow_policy {
+    block,      ///< The producer waits for the queue to have room
+    run_inline, ///< The task is executed by the producer itself
+    reject      ///< The task is rejected with an error
+};
+
+/*!
+ * \brief The options of a thread pool
+ */
+struct thread_pool_options {
+    std::size_t capacity     = 0;                     ///< The maximum number of queued tasks, 0 for unbounded
+    overflow_policy overflow = overflow_policy::block; ///< The behaviour when the queue is full
+};
+
+namespace thread_pool_detail {
+
+/*!
+ * \brief The thread pool of the thread currently running, nullptr if the
+ * thread is not a thread of a pool.
+ */
+inline thread_local const void* current_pool = nullptr;
+
+inline std::atomic<std::size_t> shared_size{0};        ///< The size requested for the shared pool, 0 for the default
+inline std::atomic<bool> shared_started{false};        ///< Indicates if the shared pool has been created
+
+/*!
+ * \brief Returns the number of threads of the shared pool: the requested
+ * size, else the CPP_UTILS_NUM_THREADS environment variable, else the
+ * hardware concurrency.
+ */
+inline std::size_t shared_pool_size() {
+    if (auto n = shared_size.load()) {
+        return n;
+    }
+
+    if (const char* env = std::getenv("CPP_UTILS_NUM_THREADS")) {
+        if (auto n = std::strtoul(env, nullptr, 10)) {
+            return n;
+        }
+    }
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/*!
+ * \brief Submit a task to the given thread pool or, if the pool rejects
+ * it (see default_thread_pool::try_do_task()), execute it directly.
+ *
+ * The tasks of the library cannot be rejected: the tasks already
+ * submitted by the same call may refer to the stack of the submitter.
+ *
+ * \param thread_pool The thread pool
+ * \param fun The functor to execute
+ * \param args The arguments to be passed to the functor
+ */
+template <typename TP, typename Functor, typename... Args>
+void do_task_or_run(TP& thread_pool, Functor&& fun, Args&&... args) {
+    if constexpr (requires { thread_pool.try_do_task(fun, args...); }) {
+        if (!thread_pool.try_do_task(fun, args...)) {
+            fun(args...);
+        }
+    } else {
+        thread_pool.do_task(std::forward<Functor>(fun), std::forward<Args>(args)...);
+    }
+}
+
+} //end of namespace thread_pool_detail
+
 /*!
  * \brief The default thread pool of hte library.
  *
@@ -34,6 +109,24 @@ namespace cpp {
  * threads cannot change. The jobs are put into a queue and threads are
  * notified. Threads are constantly waiting (passively) for jobs to be enqueue.
  *
+ * Each thread also has its own local queue, filled by do_task_on(), which
+ * it serves before the shared queue. This lets the same piece of data be
+ * processed by the same thread across several calls, keeping it warm in
+ * its caches. A thread without work steals the tasks of the local queues
+ * of the other threads, so an affinity is only a hint.
+ *
+ * The queues can be bounded with thread_pool_options. When they are full,
+ * the producer is blocked, executes the task inline or gets an error. A
+ * thread of the pool submitting a task never blocks, it executes the task
+ * inline instead, since all the threads could otherwise wait for each
+ * other.
+ *
+ * A task about to block (on I/O for instance) can declare it with a
+ * blocking_region. While it blocks, a spare thread is woken, or created if
+ * none is available, to run the queued tasks in its place. The spare
+ * threads are kept for the next blocking regions and are only released
+ * with the pool.
+ *
  * \tparam queue_t The type of queue to use (std::deque by default)
  */
 template <template <typename...> class queue_t = std::deque>
@@ -47,20 +140,217 @@ struct default_thread_pool {
     };
 
 private:
-    std::vector<std::thread> threads;                                            ///< The current threads
-    std::vector<thread_status> status;                                           ///< The status of each thread
-    queue_t<std::function<void()>, std::allocator<std::function<void()>>> tasks; ///< The queue of tasks
-    std::mutex main_lock;                                                        ///< The main lock mutex
-    std::condition_variable condition;                                           ///< The global condition variable for the main thread
-    std::condition_variable wait_condition;                                      ///< The condition variable for the threads waiting for tasks
-    volatile bool stop_flag = false;                                             ///< Flag indicating if the thread pool is currently being release
+    using task_queue = queue_t<std::function<void()>, std::allocator<std::function<void()>>>; ///< The type of a queue of tasks
+
+    std::vector<std::thread> threads;                   ///< The current threads
+    std::vector<std::thread> spare_threads;             ///< The threads compensating for the blocked threads
+    std::vector<thread_status> status;                  ///< The status of each thread
+    std::vector<char> sleeping;                         ///< Indicates if each thread is sleeping on its condition
+    task_queue tasks;                                   ///< The queue of tasks
+    std::vector<task_queue> local_tasks;                ///< The local queue of tasks of each thread
+    std::size_t queued = 0;                             ///< The number of tasks in all the queues
+    std::mutex main_lock;                               ///< The main lock mutex
+    std::vector<std::condition_variable> conditions;    ///< The condition variable of each thread, notified when it has work
+    std::condition_variable wait_condition;             ///< The condition variable for the threads waiting for tasks
+    std::condition_variable space_condition;            ///< The condition variable for the producers waiting for room in the queues
+    std::condition_variable spare_condition;            ///< The condition variable for the idle spare threads
+    std::size_t blocked       = 0;                      ///< The number of threads in a blocking region
+    std::size_t active_spares = 0;                      ///< The number of spare threads running a task
+    const thread_pool_options options;                  ///< The options of the pool
+    volatile bool stop_flag = false;                    ///< Flag indicating if the thread pool is currently being release
+
+    /*!
+     * \brief Pop the next task of the given thread: from its local queue,
+     * then from the shared queue, then stolen from the local queue of
+     * another thread. The spare threads have no local queue, their index is
+     * the number of threads. Must be called with the lock held and at
+     * least one task queued.
+     */
+    std::function<void()> pop_task(std::size_t t) {
+        std::function<void()> task;
+
+        if (t < local_tasks.size() && !local_tasks[t].empty()) {
+            task = std::move(local_tasks[t].front());
+            local_tasks[t].pop_front();
+        } else if (!tasks.empty()) {
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        } else {
+            for (std::size_t i = 0; i < local_tasks.size(); ++i) {
+                auto& victim = local_tasks[(t + 1 + i) % local_tasks.size()];
+
+                if (!victim.empty()) {
+                    task = std::move(victim.front());
+                    victim.pop_front();
+                    break;
+                }
+            }
+        }
+
+        --queued;
+
+        if (options.capacity) {
+            space_condition.notify_one();
+        }
+
+        return task;
+    }
+
+    /*!
+     * \brief Wake up a sleeping thread, the given one if possible. Must be
+     * called with the lock held.
+     * \param preferred The thread to wake up in priority
+     */
+    void wake(std::size_t preferred) {
+        if (preferred < sleeping.size() && sleeping[preferred]) {
+            sleeping[preferred] = false;
+            conditions[preferred].notify_one();
+            return;
+        }
+
+        // The preferred thread is busy, let another one steal the task
+        for (std::size_t t = 0; t < sleeping.size(); ++t) {
+            if (sleeping[t]) {
+                sleeping[t] = false;
+                conditions[t].notify_one();
+                return;
+            }
+        }
+
+        // All the threads are busy, a spare thread can run the task if some threads are blocked
+        if (active_spares < blocked) {
+            spare_condition.notify_one();
+        }
+    }
+
+    /*!
+     * \brief The loop of a spare thread, only running tasks while there
+     * are more blocked threads than running spare threads.
+     */
+    void spare_loop() {
+        thread_pool_detail::current_pool = this;
+
+        std::unique_lock<std::mutex> ulock(main_lock);
+
+        while (true) {
+            spare_condition.wait(ulock, [this] {
+                return stop_flag || (queued && active_spares < blocked);
+            });
+
+            // When the pool is stopped, the spare threads still help the blocked threads to empty the queues
+            if (!queued || active_spares >= blocked) {
+                return;
+            }
+
+            auto task = pop_task(threads.size());
+
+            ++active_spares;
+
+            ulock.unlock();
+
+            task();
+            task = nullptr;
+
+            ulock.lock();
+
+            --active_spares;
+
+            wait_condition.notify_one();
+        }
+    }
+
+    /*!
+     * \brief Fail because the pool is stopped
+     */
+    [[noreturn]] static void stopped_error() {
+#ifndef CPP_UTILS_NO_EXCEPT
+        throw std::runtime_error("cpp_utils: enqueue on stopped ThreadPool");
+#else
+        std::cerr << "cpp_utils: enqueue on stopped ThreadPool (exceptions disabled)" << std::endl;
+        std::abort();
+#endif
+    }
+
+    /*!
+     * \brief Enqueue a task in the given queue and wake up a thread.
+     *
+     * If the queues are full, the overflow policy of the pool is applied.
+     *
+     * \param queue The queue receiving the task
+     * \param preferred The thread to wake up in priority
+     * \param fail Indicates if a task that cannot be submitted is an error
+     * \return true if the task has been submitted or executed, false if it
+     * has been rejected (only without fail)
+     */
+    template <class Functor, typename... Args>
+    bool enqueue(task_queue& queue, std::size_t preferred, bool fail, Functor& fun, Args&... args) {
+        std::unique_lock<std::mutex> ulock(main_lock);
+
+        if (stop_flag) {
+            if (!fail) {
+                return false;
+            }
+
+            stopped_error();
+        }
+
+        if (options.capacity && queued >= options.capacity) {
+            if (options.overflow == overflow_policy::reject) {
+                ulock.unlock();
+
+                if (!fail) {
+                    return false;
+                }
+
+#ifndef CPP_UTILS_NO_EXCEPT
+                throw std::runtime_error("cpp_utils: ThreadPool queue is full");
+#else
+                std::cerr << "cpp_utils: ThreadPool queue is full (exceptions disabled)" << std::endl;
+                std::abort();
+#endif
+            }
+
+            if (options.overflow == overflow_policy::run_inline || in_worker()) {
+                ulock.unlock();
+
+                fun(args...);
+
+                return true;
+            }
+
+            space_condition.wait(ulock, [this] {
+                return stop_flag || queued < options.capacity;
+            });
+
+            if (stop_flag) {
+                if (!fail) {
+                    return false;
+                }
+
+                stopped_error();
+            }
+        }
+
+        //Execute the task
+        queue.emplace_back([fun, args...] () mutable {
+            fun(args...);
+        });
+
+        ++queued;
+
+        wake(preferred);
+
+        return true;
+    }
 
 public:
     /*!
      * \brief Construct a thread pool with the given number of threads
      * \param n The number of threads
+     * \param options The options of the pool
      */
-    explicit default_thread_pool(std::size_t n) : status(n, thread_status::WAITING) {
+    default_thread_pool(std::size_t n, thread_pool_options options)
+            : status(n, thread_status::WAITING), sleeping(n, false), local_tasks(n), conditions(n), options(options) {
         // The thread pool is of fixed size, avoid any possible reallocation
         threads.reserve(n);
 
@@ -69,6 +359,8 @@ public:
 
         for (std::size_t t = 0; t < n; ++t) {
             threads.emplace_back([this, t] {
+                thread_pool_detail::current_pool = this;
+
                 while (true) {
                     std::function<void()> task;
 
@@ -79,16 +371,19 @@ public:
 
                         wait_condition.notify_one();
 
-                        condition.wait(ulock, [this] {
-                            return stop_flag || !tasks.empty();
-                        });
+                        while (!stop_flag && !queued) {
+                            sleeping[t] = true;
 
-                        if (stop_flag && tasks.empty()) {
+                            conditions[t].wait(ulock, [this, t] {
+                                return !sleeping[t];
+                            });
+                        }
+
+                        if (stop_flag && !queued) {
                             return;
                         }
 
-                        task = std::move(tasks.front());
-                        tasks.pop_front();
+                        task = pop_task(t);
 
                         status[t] = thread_status::WORKING;
                     }
@@ -99,6 +394,13 @@ public:
         }
     }
 
+    /*!
+     * \brief Construct a thread pool with the given number of threads and unbounded queues
+     * \param n The number of threads
+     */
+    explicit default_thread_pool(std::size_t n)
+            : default_thread_pool(n, thread_pool_options{}) {}
+
     /*!
      * \brief Construct a thread pool with as many threads as the hardware has concurrency
      */
@@ -109,13 +411,28 @@ public:
      * \brief Destroys the thread pool and wait for the threads to be done
      */
     ~default_thread_pool() {
-        with_lock(main_lock, [this] { stop_flag = true; });
+        {
+            std::unique_lock<std::mutex> ulock(main_lock);
 
-        condition.notify_all();
+            stop_flag = true;
+            std::fill(sleeping.begin(), sleeping.end(), false);
+        }
+
+        space_condition.notify_all();
+        spare_condition.notify_all();
+
+        for (auto& condition : conditions) {
+            condition.notify_all();
+        }
 
         for (auto& thread : threads) {
             thread.join();
         }
+
+        // No more blocking region can start, spare_threads cannot change anymore
+        for (auto& thread : spare_threads) {
+            thread.join();
+        }
     }
 
     /*!
@@ -126,6 +443,46 @@ public:
         return threads.size();
     }
 
+    /*!
+     * \brief Indicates if the calling thread is one of the threads of this pool
+     */
+    bool in_worker() const {
+        return thread_pool_detail::current_pool == this;
+    }
+
+    /*!
+     * \brief Indicates that the calling thread, a thread of this pool, is
+     * going to block. A spare thread runs the queued tasks until
+     * end_blocking() is called.
+     *
+     * blocking_region should be used instead of calling this directly.
+     */
+    void begin_blocking() {
+        std::unique_lock<std::mutex> ulock(main_lock);
+
+        ++blocked;
+
+        if (stop_flag) {
+            return;
+        }
+
+        if (spare_threads.size() < blocked) {
+            spare_threads.emplace_back([this] { spare_loop(); });
+        } else if (queued) {
+            spare_condition.notify_one();
+        }
+    }
+
+    /*!
+     * \brief Indicates that the calling thread is not blocked anymore. The
+     * spare thread compensating for it stops after its current task.
+     */
+    void end_blocking() {
+        std::unique_lock<std::mutex> ulock(main_lock);
+
+        --blocked;
+    }
+
     /*!
      * \brief Wait for every thread to be done
      */
@@ -133,14 +490,14 @@ public:
         while (true) {
             std::unique_lock<std::mutex> ulock(main_lock);
 
-            if (tasks.empty() && std::find(status.begin(), status.end(), thread_status::WORKING) == status.end()) {
+            if (!queued && !active_spares && std::find(status.begin(), status.end(), thread_status::WORKING) == status.end()) {
                 return;
             }
 
             //At this point, there are still some threads working, we wait for
             //one of them to notify a change of status
             wait_condition.wait(ulock, [this] {
-                return tasks.empty();
+                return !queued;
             });
         }
     }
@@ -152,26 +509,146 @@ public:
      */
     template <class Functor, typename... Args>
     void do_task(Functor fun, Args... args) {
-        with_lock(main_lock, [fun, args..., this] () mutable {
-            if (stop_flag) {
-#ifndef CPP_UTILS_NO_EXCEPT
-                throw std::runtime_error("cpp_utils: enqueue on stopped ThreadPool");
-#else
-                std::cerr << "cpp_utils: enqueue on stopped ThreadPool (exceptions disabled)" << std::endl;
-                std::abort();
-#endif
-            }
+        enqueue(tasks, size(), true, fun, args...);
+    }
 
-            //Execute the task
-            tasks.emplace_back([fun, args...] () mutable {
-                fun(args...);
-            });
-        });
+    /*!
+     * \brief Submit a task to the pool, unless the overflow policy rejects
+     * it or the pool is stopped.
+     *
+     * This is used by the parallel algorithms, which cannot give up once
+     * some of their tasks are submitted and execute the rejected tasks
+     * themselves.
+     *
+     * \param fun The functor to execute
+     * \param args The arguments to be passed to the functor
+     * \return true if the task has been submitted (or executed), false if it has been rejected
+     */
+    template <class Functor, typename... Args>
+    bool try_do_task(Functor fun, Args... args) {
+        return enqueue(tasks, size(), false, fun, args...);
+    }
+
+    /*!
+     * \brief Submit a task to the pool, preferably executed by the given thread.
+     *
+     * Submitting the tasks working on the same data to the same thread lets
+     * them reuse its caches. The task may still be stolen by another thread
+     * if the given thread is busy.
+     *
+     * \param worker The index of the preferred thread, modulo the number of threads
+     * \param fun The functor to execute
+     * \param args The arguments to be passed to the functor
+     */
+    template <class Functor, typename... Args>
+    void do_task_on(std::size_t worker, Functor fun, Args... args) {
+        if (threads.empty()) {
+            do_task(fun, args...);
+            return;
+        }
 
-        condition.notify_one();
+        worker %= size();
+
+        enqueue(local_tasks[worker], worker, true, fun, args...);
+    }
+
+    /*!
+     * \brief Submit a task to the pool, preferably executed by the given
+     * thread, unless the overflow policy rejects it or the pool is stopped
+     * (see try_do_task()).
+     *
+     * \param worker The index of the preferred thread, modulo the number of threads
+     * \param fun The functor to execute
+     * \param args The arguments to be passed to the functor
+     * \return true if the task has been submitted (or executed), false if it has been rejected
+     */
+    template <class Functor, typename... Args>
+    bool try_do_task_on(std::size_t worker, Functor fun, Args... args) {
+        if (threads.empty()) {
+            return try_do_task(fun, args...);
+        }
+
+        worker %= size();
+
+        return enqueue(local_tasks[worker], worker, false, fun, args...);
     }
 };
 
+/*!
+ * \brief A scope during which the current task of a thread pool is blocked
+ * (waiting on I/O for instance) and a spare thread runs the other tasks.
+ *
+ * \code
+ * pool.do_task([&pool] {
+ *     cpp::blocking_region region(pool);
+ *     read_file();
+ * });
+ * \endcode
+ *
+ * Outside of the threads of the pool, the region has no effect.
+ *
+ * \tparam TP The type of thread pool
+ */
+template <typename TP>
+struct blocking_region {
+    /*!
+     * \brief Enter the blocking region
+     * \param thread_pool The thread pool running the current task
+     */
+    explicit blocking_region(TP& thread_pool) : pool(thread_pool), active(thread_pool.in_worker()) {
+        if (active) {
+            pool.begin_blocking();
+        }
+    }
+
+    blocking_region(const blocking_region& rhs) = delete;
+    blocking_region& operator=(const blocking_region& rhs) = delete;
+
+    /*!
+     * \brief Leave the blocking region
+     */
+    ~blocking_region() {
+        if (active) {
+            pool.end_blocking();
+        }
+    }
+
+private:
+    TP& pool;          ///< The thread pool
+    const bool active; ///< Indicates if the region is in a thread of the pool
+};
+
+/*!
+ * \brief Set the number of threads of the shared thread pool.
+ *
+ * This has only an effect before the first use of the shared pool.
+ *
+ * \param n The number of threads, 0 for the default
+ * \return true if the size will be used, false if the pool is already started
+ */
+inline bool set_shared_thread_pool_size(std::size_t n) {
+    thread_pool_detail::shared_size = n;
+    return !thread_pool_detail::shared_started;
+}
+
+/*!
+ * \brief Returns the thread pool shared by the whole process.
+ *
+ * The pool is created, and its threads started, on the first call. Its
+ * size is set by set_shared_thread_pool_size(), else by the
+ * CPP_UTILS_NUM_THREADS environment variable, else it is the hardware
+ * concurrency. Using this pool instead of creating one pool per component
+ * avoids oversubscribing the cores.
+ */
+inline default_thread_pool<>& shared_thread_pool() {
+    static default_thread_pool<> pool([] {
+        thread_pool_detail::shared_started = true;
+        return thread_pool_detail::shared_pool_size();
+    }());
+
+    return pool;
+}
+
 } //end of the cpp namespace
 
 #endif //CPP_UTILS_THREAD_POOL_HPP
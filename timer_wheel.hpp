@@ -0,0 +1,336 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file timer_wheel.hpp
+ * \brief Contains a hierarchical timing wheel scheduling delayed and
+ * periodic tasks on a thread pool.
+ */
+
+#ifndef CPP_UTILS_TIMER_WHEEL_HPP
+#define CPP_UTILS_TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace cpp {
+
+/*!
+ * \brief A hierarchical timing wheel, handing the expired tasks to a
+ * thread pool.
+ *
+ * A single timer thread advances the wheel one tick at a time. The wheel
+ * has 4 levels of 64 slots, level L covering 64^(L+1) ticks. A timer is
+ * put in the slot of its expiration tick at the lowest level covering its
+ * delay and the timers of a higher level slot are moved (cascaded) to the
+ * lower levels when the wheel reaches it. Scheduling and cancelling a
+ * timer and processing a tick are O(1), regardless of the number of
+ * timers. Delays longer than the wheel are cascaded again until they
+ * expire.
+ *
+ * The expired tasks are executed by the thread pool, never by the timer
+ * thread itself. A timer expires at the first tick following its delay,
+ * its resolution is the tick duration.
+ *
+ * \tparam TP The type of thread pool
+ */
+template <typename TP>
+struct timer_wheel {
+    using clock    = std::chrono::steady_clock; ///< The clock of the timers
+    using timer_id = uint64_t;                  ///< The identifier of a timer
+
+    static constexpr std::size_t levels    = 4;                           ///< The number of levels of the wheel
+    static constexpr std::size_t slot_bits = 6;                           ///< The number of bits of a slot index
+    static constexpr std::size_t slots     = std::size_t(1) << slot_bits; ///< The number of slots per level
+
+    /*!
+     * \brief Construct a timer wheel handing its tasks to the given thread pool
+     * \param thread_pool The thread pool executing the expired tasks
+     * \param tick The duration of one tick of the wheel
+     */
+    explicit timer_wheel(TP& thread_pool, clock::duration tick = std::chrono::milliseconds(1))
+            : pool(thread_pool), tick(tick), start(clock::now()) {
+        timer_thread = std::thread([this] { run(); });
+    }
+
+    timer_wheel(const timer_wheel& rhs) = delete;
+    timer_wheel& operator=(const timer_wheel& rhs) = delete;
+
+    /*!
+     * \brief Stop the timer thread. The pending timers are discarded.
+     */
+    ~timer_wheel() {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            stop_flag = true;
+        }
+
+        condition.notify_one();
+        timer_thread.join();
+    }
+
+    /*!
+     * \brief Schedule the given functor to run once, after the given delay
+     * \param delay The delay before running the functor
+     * \param fun The functor to run
+     * \return The identifier of the timer, to cancel it
+     */
+    template <typename Rep, typename Period, typename Functor>
+    timer_id schedule_after(std::chrono::duration<Rep, Period> delay, Functor fun) {
+        return schedule(delay, 0, std::function<void()>(std::move(fun)));
+    }
+
+    /*!
+     * \brief Schedule the given functor to run periodically, the first time after one period.
+     *
+     * The period is rounded up to a whole number of ticks. The timer keeps
+     * its rate, the next expiration is computed from the previous
+     * expiration and not from the end of the task.
+     *
+     * \param period The period of the timer
+     * \param fun The functor to run
+     * \return The identifier of the timer, to cancel it
+     */
+    template <typename Rep, typename Period, typename Functor>
+    timer_id schedule_every(std::chrono::duration<Rep, Period> period, Functor fun) {
+        return schedule(period, std::max(uint64_t(1), to_ticks(period)), std::function<void()>(std::move(fun)));
+    }
+
+    /*!
+     * \brief Cancel the given timer.
+     *
+     * A task already handed to the thread pool is not cancelled, but a
+     * periodic timer will not run again.
+     *
+     * \param id The identifier of the timer
+     * \return true if the timer was pending, false otherwise
+     */
+    bool cancel(timer_id id) {
+        std::unique_lock<std::mutex> l(lock);
+        return timers.erase(id) > 0;
+    }
+
+    /*!
+     * \brief Returns the number of pending timers
+     */
+    std::size_t pending() const {
+        std::unique_lock<std::mutex> l(lock);
+        return timers.size();
+    }
+
+private:
+    /*!
+     * \brief A pending timer
+     */
+    struct timer {
+        uint64_t expiry;            ///< The tick at which the timer expires
+        uint64_t period;            ///< The period, in ticks, 0 for one-shot timers
+        std::function<void()> task; ///< The task to run
+    };
+
+    uint64_t to_ticks(clock::duration duration) const {
+        return static_cast<uint64_t>((duration + tick - clock::duration(1)) / tick);
+    }
+
+    timer_id schedule(clock::duration delay, uint64_t period, std::function<void()> task) {
+        const uint64_t expiry = to_ticks(clock::now() - start + delay);
+
+        timer_id id;
+        bool was_empty;
+
+        {
+            std::unique_lock<std::mutex> l(lock);
+
+            skip_idle_ticks();
+
+            id        = ++last_id;
+            was_empty = timers.empty();
+
+            timers.emplace(id, timer{expiry, period, std::move(task)});
+            insert(id, expiry);
+        }
+
+        // The timer thread sleeps without timeout when there are no timers
+        if (was_empty) {
+            condition.notify_one();
+        }
+
+        return id;
+    }
+
+    /*!
+     * \brief Returns the tick of the current time
+     */
+    uint64_t now_tick() const {
+        return (clock::now() - start) / tick;
+    }
+
+    /*!
+     * \brief Move the wheel directly to the current tick when no timer is
+     * pending, instead of advancing it through all the idle ticks. Must be
+     * called with the lock held.
+     *
+     * The slots can only contain cancelled timers, they are cleared.
+     */
+    void skip_idle_ticks() {
+        if (!timers.empty()) {
+            return;
+        }
+
+        if (const uint64_t now = now_tick(); now > current) {
+            current = now;
+
+            for (auto& level : wheel) {
+                for (auto& slot : level) {
+                    slot.clear();
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Insert the timer in the slot of its expiration, at the lowest
+     * level covering its delay. Must be called with the lock held.
+     *
+     * When cascading, the slot of the current tick has not been processed
+     * yet and can still receive the timers expiring now.
+     */
+    void insert(timer_id id, uint64_t expiry, bool cascading = false) {
+        expiry = std::max(expiry, cascading ? current : current + 1);
+
+        const uint64_t delta = expiry - current;
+
+        for (std::size_t level = 0; level < levels; ++level) {
+            if (level + 1 == levels || delta < (uint64_t(1) << (slot_bits * (level + 1)))) {
+                // Too far timers are put at the end of the last level and cascaded again
+                const uint64_t max_expiry = current + (uint64_t(1) << (slot_bits * levels)) - 1;
+                const uint64_t position   = std::min(expiry, max_expiry) >> (slot_bits * level);
+
+                wheel[level][position & (slots - 1)].push_back(id);
+                return;
+            }
+        }
+    }
+
+    /*!
+     * \brief Advance the wheel by one tick and collect the expired tasks.
+     * Must be called with the lock held.
+     */
+    void advance(std::vector<std::function<void()>>& ready) {
+        ++current;
+
+        // Cascade the higher levels whose slot starts at this tick, from the highest
+        for (std::size_t level = levels - 1; level > 0; --level) {
+            if (current & ((uint64_t(1) << (slot_bits * level)) - 1)) {
+                continue;
+            }
+
+            auto ids = std::move(wheel[level][(current >> (slot_bits * level)) & (slots - 1)]);
+            wheel[level][(current >> (slot_bits * level)) & (slots - 1)].clear();
+
+            for (auto id : ids) {
+                if (auto it = timers.find(id); it != timers.end()) {
+                    insert(id, it->second.expiry, true);
+                }
+            }
+        }
+
+        auto ids = std::move(wheel[0][current & (slots - 1)]);
+        wheel[0][current & (slots - 1)].clear();
+
+        for (auto id : ids) {
+            auto it = timers.find(id);
+
+            // Cancelled timers are simply dropped from their slot
+            if (it == timers.end()) {
+                continue;
+            }
+
+            auto& t = it->second;
+
+            if (t.expiry > current) {
+                insert(id, t.expiry);
+            } else if (t.period) {
+                ready.push_back(t.task);
+                t.expiry += t.period;
+                insert(id, t.expiry);
+            } else {
+                ready.push_back(std::move(t.task));
+                timers.erase(it);
+            }
+        }
+    }
+
+    /*!
+     * \brief The loop of the timer thread
+     */
+    void run() {
+        std::vector<std::function<void()>> ready;
+
+        std::unique_lock<std::mutex> l(lock);
+
+        while (!stop_flag) {
+            skip_idle_ticks();
+
+            const uint64_t now = now_tick();
+
+            while (current < now) {
+                advance(ready);
+            }
+
+            if (!ready.empty()) {
+                l.unlock();
+
+                // A task rejected by the thread pool is run by the timer thread
+                for (auto& task : ready) {
+                    thread_pool_detail::do_task_or_run(pool, std::move(task));
+                }
+
+                ready.clear();
+
+                l.lock();
+                continue;
+            }
+
+            if (timers.empty()) {
+                condition.wait(l);
+            } else {
+                condition.wait_until(l, start + tick * (current + 1));
+            }
+        }
+    }
+
+    TP& pool;                      ///< The thread pool running the tasks
+    const clock::duration tick;    ///< The duration of a tick
+    const clock::time_point start; ///< The time of the tick 0
+
+    mutable std::mutex lock;           ///< The lock protecting the wheel and the timers
+    std::condition_variable condition; ///< The condition to wake the timer thread
+    bool stop_flag   = false;          ///< Indicates if the timer thread must stop
+    uint64_t current = 0;              ///< The last processed tick
+    timer_id last_id = 0;              ///< The last given identifier
+
+    std::unordered_map<timer_id, timer> timers;                          ///< The pending timers
+    std::array<std::array<std::vector<timer_id>, slots>, levels> wheel; ///< The slots of each level
+
+    std::thread timer_thread; ///< The timer thread
+};
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_TIMER_WHEEL_HPP
@@ -0,0 +1,943 @@
+//=======================================================================
+// Copyright (c) 2013-2020 Baptiste Wicht
+// Distributed under the terms of the MIT License.
+// (See accompanying file LICENSE or copy at
+//  http://opensource.org/licenses/MIT)
+//=======================================================================
+
+/*!
+ * \file views.hpp
+ * \brief Contains lazy range adaptors (transform, filter, zip, enumerate,
+ * chunk and stride).
+ *
+ * The adaptors do not store any element, they compute them when iterated.
+ * They can be used with the foreach family of algorithms and with the
+ * parallel_foreach family. Views built on lvalues keep a reference to them
+ * while views built on rvalues (for instance other views) keep a copy.
+ *
+ * Views over random access ranges have random access iterators, so that the
+ * parallel algorithms can split them directly. Views also expose
+ * base_size() and slice(first, last) to split them by position in their
+ * underlying range, which is how filtered ranges are split among threads.
+ */
+
+#ifndef CPP_UTILS_VIEWS_HPP
+#define CPP_UTILS_VIEWS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "assert.hpp"
+
+namespace cpp {
+
+/*!
+ * \brief A range defined by a pair of iterators
+ * \tparam Iterator The type of iterator
+ */
+template <typename Iterator>
+struct iterator_range {
+    using iterator = Iterator; ///< The type of iterator
+
+    /*!
+     * \brief Construct an empty range
+     */
+    iterator_range() = default;
+
+    /*!
+     * \brief Construct the range [first, last)
+     */
+    iterator_range(Iterator first, Iterator last) : first(first), last(last) {
+        //Nothing else to init
+    }
+
+    /*!
+     * \brief Returns an iterator to the beginning of the range
+     */
+    Iterator begin() const {
+        return first;
+    }
+
+    /*!
+     * \brief Returns an iterator past the end of the range
+     */
+    Iterator end() const {
+        return last;
+    }
+
+    /*!
+     * \brief Returns the number of elements in the range
+     */
+    std::size_t size() const {
+        return std::distance(first, last);
+    }
+
+    /*!
+     * \brief Indicates if the range is empty
+     */
+    bool empty() const {
+        return first == last;
+    }
+
+    /*!
+     * \brief Returns the i-th element of the range (random access only)
+     */
+    decltype(auto) operator[](std::size_t i) const {
+        return first[i];
+    }
+
+private:
+    Iterator first; ///< The beginning of the range
+    Iterator last;  ///< The end of the range
+};
+
+namespace range_detail {
+
+/*!
+ * \brief The type used to access a stored base range from a const view.
+ *
+ * Views over lvalues keep a reference (whose constness is preserved) while
+ * views over rvalues keep a value, accessed as const.
+ */
+template <typename R>
+using stored_ref_t = std::conditional_t<std::is_lvalue_reference_v<R>, R, const std::remove_reference_t<R>&>;
+
+/*!
+ * \brief The type of iterator of a stored base range
+ */
+template <typename R>
+using iterator_t = decltype(std::begin(std::declval<stored_ref_t<R>>()));
+
+/*!
+ * \brief The reference type of a stored base range
+ */
+template <typename R>
+using reference_t = typename std::iterator_traits<iterator_t<R>>::reference;
+
+/*!
+ * \brief Indicates if the given iterator has at least the given category
+ */
+template <typename Iterator, typename Tag>
+constexpr bool has_category = std::is_base_of_v<Tag, typename std::iterator_traits<Iterator>::iterator_category>;
+
+/*!
+ * \brief Indicates if the given stored range has random access iterators
+ */
+template <typename R>
+constexpr bool is_random_access = has_category<iterator_t<R>, std::random_access_iterator_tag>;
+
+/*!
+ * \brief The iterator category of a view, capped to random access
+ */
+template <typename... Iterator>
+using category_t = std::conditional_t<
+    (... && has_category<Iterator, std::random_access_iterator_tag>), std::random_access_iterator_tag,
+    std::conditional_t<(... && has_category<Iterator, std::bidirectional_iterator_tag>), std::bidirectional_iterator_tag,
+                       std::conditional_t<(... && has_category<Iterator, std::forward_iterator_tag>), std::forward_iterator_tag, std::input_iterator_tag>>>;
+
+/*!
+ * \brief Indicates if a range can be sliced by position in its underlying range
+ */
+template <typename R>
+concept sliceable = requires(stored_ref_t<R> r, std::size_t i) {
+    r.slice(i, i);
+    r.base_size();
+} || is_random_access<R>;
+
+/*!
+ * \brief Returns the size of the underlying range of the given range
+ */
+template <typename R>
+std::size_t base_size(R&& r) {
+    if constexpr (requires { r.base_size(); }) {
+        return r.base_size();
+    } else {
+        return std::distance(std::begin(r), std::end(r));
+    }
+}
+
+/*!
+ * \brief Returns the sub range [first, last) of the given range, by position in its underlying range
+ */
+template <typename R>
+auto slice(R&& r, std::size_t first, std::size_t last) {
+    if constexpr (requires { r.slice(first, last); }) {
+        return r.slice(first, last);
+    } else {
+        auto it = std::begin(r);
+        return iterator_range<decltype(it)>(it + first, it + last);
+    }
+}
+
+/*!
+ * \brief Base class implementing all the iterator operators from a
+ * minimal set of functions of the derived iterator: dereference(),
+ * increment(), equal() and for bidirectional and random access iterators,
+ * decrement(), advance() and distance_to().
+ */
+template <typename D, typename Category, typename Value, typename Reference>
+struct iterator_facade {
+    using iterator_category = Category;       ///< The iterator category
+    using value_type        = Value;          ///< The value type
+    using difference_type   = std::ptrdiff_t; ///< The difference type
+    using reference         = Reference;      ///< The reference type
+    using pointer           = void;           ///< The pointer type
+
+    reference operator*() const {
+        return self().dereference();
+    }
+
+    D& operator++() {
+        self().increment();
+        return self();
+    }
+
+    D operator++(int) {
+        D tmp = self();
+        self().increment();
+        return tmp;
+    }
+
+    D& operator--() {
+        self().decrement();
+        return self();
+    }
+
+    D operator--(int) {
+        D tmp = self();
+        self().decrement();
+        return tmp;
+    }
+
+    D& operator+=(difference_type n) {
+        self().advance(n);
+        return self();
+    }
+
+    D& operator-=(difference_type n) {
+        self().advance(-n);
+        return self();
+    }
+
+    reference operator[](difference_type n) const {
+        D tmp = self();
+        tmp.advance(n);
+        return tmp.dereference();
+    }
+
+    friend D operator+(D it, difference_type n) {
+        return it += n;
+    }
+
+    friend D operator+(difference_type n, D it) {
+        return it += n;
+    }
+
+    friend D operator-(D it, difference_type n) {
+        return it -= n;
+    }
+
+    friend difference_type operator-(const D& lhs, const D& rhs) {
+        return rhs.distance_to(lhs);
+    }
+
+    friend bool operator==(const D& lhs, const D& rhs) {
+        return lhs.equal(rhs);
+    }
+
+    friend bool operator!=(const D& lhs, const D& rhs) {
+        return !lhs.equal(rhs);
+    }
+
+    friend bool operator<(const D& lhs, const D& rhs) {
+        return lhs.distance_to(rhs) > 0;
+    }
+
+    friend bool operator>(const D& lhs, const D& rhs) {
+        return rhs < lhs;
+    }
+
+    friend bool operator<=(const D& lhs, const D& rhs) {
+        return !(rhs < lhs);
+    }
+
+    friend bool operator>=(const D& lhs, const D& rhs) {
+        return !(lhs < rhs);
+    }
+
+private:
+    D& self() {
+        return static_cast<D&>(*this);
+    }
+
+    const D& self() const {
+        return static_cast<const D&>(*this);
+    }
+};
+
+} //end of namespace range_detail
+
+/*!
+ * \brief A view of the transformation of each element of a range.
+ *
+ * The functor is called each time an element is accessed.
+ *
+ * \tparam R The type of the base range (a reference for lvalues)
+ * \tparam F The type of the functor
+ */
+template <typename R, typename F>
+struct transform_view {
+    using base_iterator = range_detail::iterator_t<R>;                                                  ///< The iterator of the base range
+    using reference     = decltype(std::declval<const F&>()(std::declval<range_detail::reference_t<R>>())); ///< The type of the transformed elements
+
+    /*!
+     * \brief The iterator of the transform view
+     */
+    struct iterator : range_detail::iterator_facade<iterator, range_detail::category_t<base_iterator>, std::remove_cvref_t<reference>, reference> {
+        base_iterator it;     ///< The current position in the base range
+        const F* fun = nullptr; ///< The transform functor
+
+        iterator() = default;
+        iterator(base_iterator it, const F* fun) : it(it), fun(fun) {}
+
+        reference dereference() const {
+            return (*fun)(*it);
+        }
+
+        void increment() {
+            ++it;
+        }
+
+        void decrement() {
+            --it;
+        }
+
+        void advance(std::ptrdiff_t n) {
+            it += n;
+        }
+
+        std::ptrdiff_t distance_to(const iterator& other) const {
+            return other.it - it;
+        }
+
+        bool equal(const iterator& other) const {
+            return it == other.it;
+        }
+    };
+
+    /*!
+     * \brief Construct the view
+     */
+    transform_view(R&& base, F fun) : base(std::forward<R>(base)), fun(std::move(fun)) {}
+
+    /*!
+     * \brief Returns an iterator to the first element of the view
+     */
+    iterator begin() const {
+        return {std::begin(base), &fun};
+    }
+
+    /*!
+     * \brief Returns an iterator past the last element of the view
+     */
+    iterator end() const {
+        return {std::end(base), &fun};
+    }
+
+    /*!
+     * \brief Returns the number of elements of the view
+     */
+    std::size_t size() const requires range_detail::is_random_access<R> {
+        return end() - begin();
+    }
+
+    /*!
+     * \brief Returns the size of the underlying range
+     */
+    std::size_t base_size() const {
+        return range_detail::base_size(base);
+    }
+
+    /*!
+     * \brief Returns a view of the elements of the sub range [first, last) of the underlying range
+     */
+    auto slice(std::size_t first, std::size_t last) const requires range_detail::sliceable<R> {
+        using sub_range = decltype(range_detail::slice(base, first, last));
+        return transform_view<sub_range, F>(range_detail::slice(base, first, last), fun);
+    }
+
+private:
+    R base; ///< The base range
+    F fun;  ///< The transform functor
+};
+
+/*!
+ * \brief A view of the elements of a range that satisfy a predicate.
+ *
+ * The predicate is evaluated while iterating, the iterators are at most
+ * forward iterators. The view can still be split among threads by
+ * positions in the underlying range (see slice()).
+ *
+ * \tparam R The type of the base range (a reference for lvalues)
+ * \tparam P The type of the predicate
+ */
+template <typename R, typename P>
+struct filter_view {
+    using base_iterator = range_detail::iterator_t<R>; ///< The iterator of the base range
+    using reference     = range_detail::reference_t<R>; ///< The type of the elements
+
+    /*!
+     * \brief The iterator of the filter view
+     */
+    struct iterator : range_detail::iterator_facade<iterator, std::conditional_t<range_detail::has_category<base_iterator, std::forward_iterator_tag>, std::forward_iterator_tag, std::input_iterator_tag>, typename std::iterator_traits<base_iterator>::value_type, reference> {
+        base_iterator it;        ///< The current position in the base range
+        base_iterator last;      ///< The end of the base range
+        const P* pred = nullptr; ///< The predicate
+
+        iterator() = default;
+        iterator(base_iterator it, base_iterator last, const P* pred) : it(it), last(last), pred(pred) {
+            satisfy();
+        }
+
+        reference dereference() const {
+            return *it;
+        }
+
+        void increment() {
+            ++it;
+            satisfy();
+        }
+
+        bool equal(const iterator& other) const {
+            return it == other.it;
+        }
+
+    private:
+        void satisfy() {
+            while (it != last && !(*pred)(*it)) {
+                ++it;
+            }
+        }
+    };
+
+    /*!
+     * \brief Construct the view
+     */
+    filter_view(R&& base, P pred) : base(std::forward<R>(base)), pred(std::move(pred)) {}
+
+    /*!
+     * \brief Returns an iterator to the first element of the view
+     */
+    iterator begin() const {
+        return {std::begin(base), std::end(base), &pred};
+    }
+
+    /*!
+     * \brief Returns an iterator past the last element of the view
+     */
+    iterator end() const {
+        return {std::end(base), std::end(base), &pred};
+    }
+
+    /*!
+     * \brief Returns the size of the underlying range
+     */
+    std::size_t base_size() const {
+        return range_detail::base_size(base);
+    }
+
+    /*!
+     * \brief Returns a view of the elements of the sub range [first, last) of the underlying range
+     */
+    auto slice(std::size_t first, std::size_t last) const requires range_detail::sliceable<R> {
+        using sub_range = decltype(range_detail::slice(base, first, last));
+        return filter_view<sub_range, P>(range_detail::slice(base, first, last), pred);
+    }
+
+private:
+    R base; ///< The base range
+    P pred; ///< The predicate
+};
+
+/*!
+ * \brief A view of the tuples of elements at the same position in several ranges.
+ *
+ * The view stops at the end of the shortest range. Each element is a
+ * std::tuple of the references of the elements of the ranges.
+ *
+ * \tparam R The types of the base ranges (references for lvalues)
+ */
+template <typename... R>
+struct zip_view {
+    using reference = std::tuple<range_detail::reference_t<R>...>; ///< The type of the elements
+
+    /*!
+     * \brief The iterator of the zip view
+     */
+    struct iterator : range_detail::iterator_facade<iterator, range_detail::category_t<range_detail::iterator_t<R>...>, std::tuple<typename std::iterator_traits<range_detail::iterator_t<R>>::value_type...>, reference> {
+        std::tuple<range_detail::iterator_t<R>...> its; ///< The current position in each range
+
+        iterator() = default;
+        explicit iterator(std::tuple<range_detail::iterator_t<R>...> its) : its(its) {}
+
+        reference dereference() const {
+            return std::apply([](auto&... it) { return reference(*it...); }, its);
+        }
+
+        void increment() {
+            std::apply([](auto&... it) { (++it, ...); }, its);
+        }
+
+        void decrement() {
+            std::apply([](auto&... it) { (--it, ...); }, its);
+        }
+
+        void advance(std::ptrdiff_t n) {
+            std::apply([n](auto&... it) { ((it += n), ...); }, its);
+        }
+
+        std::ptrdiff_t distance_to(const iterator& other) const {
+            return std::get<0>(other.its) - std::get<0>(its);
+        }
+
+        bool equal(const iterator& other) const {
+            // Stop as soon as any range is exhausted
+            return equal_impl(other, std::index_sequence_for<R...>());
+        }
+
+    private:
+        template <std::size_t... I>
+        bool equal_impl(const iterator& other, std::index_sequence<I...> /*seq*/) const {
+            return (... || (std::get<I>(its) == std::get<I>(other.its)));
+        }
+    };
+
+    /*!
+     * \brief Construct the view
+     */
+    explicit zip_view(R&&... bases) : bases(std::forward<R>(bases)...) {}
+
+    /*!
+     * \brief Returns an iterator to the first element of the view
+     */
+    iterator begin() const {
+        return iterator(std::apply([](auto&... b) { return std::make_tuple(std::begin(b)...); }, bases));
+    }
+
+    /*!
+     * \brief Returns an iterator past the last element of the view
+     */
+    iterator end() const {
+        if constexpr ((... && range_detail::is_random_access<R>)) {
+            // All the ends must be at the same position to compute distances
+            return begin() + size();
+        } else {
+            return iterator(std::apply([](auto&... b) { return std::make_tuple(std::end(b)...); }, bases));
+        }
+    }
+
+    /*!
+     * \brief Returns the number of elements of the view
+     */
+    std::size_t size() const requires(... && range_detail::is_random_access<R>) {
+        return base_size();
+    }
+
+    /*!
+     * \brief Returns the size of the shortest range
+     */
+    std::size_t base_size() const {
+        return std::apply([](auto&... b) { return std::min({range_detail::base_size(b)...}); }, bases);
+    }
+
+    /*!
+     * \brief Returns a view of the elements [first, last) of the view
+     */
+    auto slice(std::size_t first, std::size_t last) const requires(... && range_detail::is_random_access<R>) {
+        return std::apply([first, last](auto&... b) {
+            return zip_view<decltype(range_detail::slice(b, first, last))...>(range_detail::slice(b, first, last)...);
+        }, bases);
+    }
+
+private:
+    std::tuple<R...> bases; ///< The base ranges
+};
+
+/*!
+ * \brief A view of the elements of a range with their position.
+ *
+ * Each element is a std::pair of the position and the reference to the
+ * element of the range.
+ *
+ * \tparam R The type of the base range (a reference for lvalues)
+ */
+template <typename R>
+struct enumerate_view {
+    using base_iterator = range_detail::iterator_t<R>;                          ///< The iterator of the base range
+    using reference     = std::pair<std::size_t, range_detail::reference_t<R>>; ///< The type of the elements
+
+    /*!
+     * \brief The iterator of the enumerate view
+     */
+    struct iterator : range_detail::iterator_facade<iterator, range_detail::category_t<base_iterator>, std::pair<std::size_t, typename std::iterator_traits<base_iterator>::value_type>, reference> {
+        base_iterator it;  ///< The current position in the base range
+        std::size_t i = 0; ///< The current index
+
+        iterator() = default;
+        iterator(base_iterator it, std::size_t i) : it(it), i(i) {}
+
+        reference dereference() const {
+            return reference(i, *it);
+        }
+
+        void increment() {
+            ++it;
+            ++i;
+        }
+
+        void decrement() {
+            --it;
+            --i;
+        }
+
+        void advance(std::ptrdiff_t n) {
+            it += n;
+            i += n;
+        }
+
+        std::ptrdiff_t distance_to(const iterator& other) const {
+            return other.it - it;
+        }
+
+        bool equal(const iterator& other) const {
+            return it == other.it;
+        }
+    };
+
+    /*!
+     * \brief Construct the view
+     * \param base The base range
+     * \param offset The index of the first element
+     */
+    explicit enumerate_view(R&& base, std::size_t offset = 0) : base(std::forward<R>(base)), offset(offset) {}
+
+    /*!
+     * \brief Returns an iterator to the first element of the view
+     */
+    iterator begin() const {
+        return {std::begin(base), offset};
+    }
+
+    /*!
+     * \brief Returns an iterator past the last element of the view
+     */
+    iterator end() const {
+        if constexpr (range_detail::is_random_access<R>) {
+            return {std::end(base), offset + (std::end(base) - std::begin(base))};
+        } else {
+            return {std::end(base), 0};
+        }
+    }
+
+    /*!
+     * \brief Returns the number of elements of the view
+     */
+    std::size_t size() const requires range_detail::is_random_access<R> {
+        return std::end(base) - std::begin(base);
+    }
+
+    /*!
+     * \brief Returns the size of the underlying range
+     */
+    std::size_t base_size() const {
+        return range_detail::base_size(base);
+    }
+
+    /*!
+     * \brief Returns a view of the elements [first, last) of the view, keeping their indices
+     */
+    auto slice(std::size_t first, std::size_t last) const requires range_detail::is_random_access<R> {
+        using sub_range = decltype(range_detail::slice(base, first, last));
+        return enumerate_view<sub_range>(range_detail::slice(base, first, last), offset + first);
+    }
+
+private:
+    R base;             ///< The base range
+    std::size_t offset; ///< The index of the first element
+};
+
+/*!
+ * \brief A view of the consecutive chunks of a fixed size of a random access range.
+ *
+ * Each element is an iterator_range of the elements of the chunk. The last
+ * chunk may be smaller than the others.
+ *
+ * \tparam R The type of the base range (a reference for lvalues)
+ */
+template <typename R>
+struct chunk_view {
+    static_assert(range_detail::is_random_access<R>, "chunk_view is only supported on random access ranges");
+
+    using base_iterator = range_detail::iterator_t<R>;   ///< The iterator of the base range
+    using reference     = iterator_range<base_iterator>; ///< The type of the elements
+
+    /*!
+     * \brief The iterator of the chunk view
+     */
+    struct iterator : range_detail::iterator_facade<iterator, std::random_access_iterator_tag, reference, reference> {
+        base_iterator first;  ///< The beginning of the base range
+        std::size_t i = 0;    ///< The index of the current chunk
+        std::size_t k = 1;    ///< The size of the chunks
+        std::size_t n = 0;    ///< The size of the base range
+
+        iterator() = default;
+        iterator(base_iterator first, std::size_t i, std::size_t k, std::size_t n) : first(first), i(i), k(k), n(n) {}
+
+        reference dereference() const {
+            return {first + i * k, first + std::min(n, (i + 1) * k)};
+        }
+
+        void increment() {
+            ++i;
+        }
+
+        void decrement() {
+            --i;
+        }
+
+        void advance(std::ptrdiff_t d) {
+            i += d;
+        }
+
+        std::ptrdiff_t distance_to(const iterator& other) const {
+            return std::ptrdiff_t(other.i) - std::ptrdiff_t(i);
+        }
+
+        bool equal(const iterator& other) const {
+            return i == other.i;
+        }
+    };
+
+    /*!
+     * \brief Construct the view
+     * \param base The base range
+     * \param k The size of the chunks
+     */
+    chunk_view(R&& base, std::size_t k) : base(std::forward<R>(base)), k(k) {
+        cpp_assert(k > 0, "chunk_view needs chunks of at least one element");
+    }
+
+    /*!
+     * \brief Returns an iterator to the first chunk
+     */
+    iterator begin() const {
+        return {std::begin(base), 0, k, n()};
+    }
+
+    /*!
+     * \brief Returns an iterator past the last chunk
+     */
+    iterator end() const {
+        return {std::begin(base), size(), k, n()};
+    }
+
+    /*!
+     * \brief Returns the number of chunks
+     */
+    std::size_t size() const {
+        return (n() + k - 1) / k;
+    }
+
+    /*!
+     * \brief Returns the number of chunks
+     */
+    std::size_t base_size() const {
+        return size();
+    }
+
+    /*!
+     * \brief Returns a view of the chunks [first, last) of the view
+     */
+    auto slice(std::size_t first, std::size_t last) const {
+        using sub_range = decltype(range_detail::slice(base, 0, 0));
+        return chunk_view<sub_range>(range_detail::slice(base, std::min(n(), first * k), std::min(n(), last * k)), k);
+    }
+
+private:
+    std::size_t n() const {
+        return std::end(base) - std::begin(base);
+    }
+
+    R base;        ///< The base range
+    std::size_t k; ///< The size of the chunks
+};
+
+/*!
+ * \brief A view of every s-th element of a random access range, starting from the first.
+ *
+ * \tparam R The type of the base range (a reference for lvalues)
+ */
+template <typename R>
+struct stride_view {
+    static_assert(range_detail::is_random_access<R>, "stride_view is only supported on random access ranges");
+
+    using base_iterator = range_detail::iterator_t<R>;  ///< The iterator of the base range
+    using reference     = range_detail::reference_t<R>; ///< The type of the elements
+
+    /*!
+     * \brief The iterator of the stride view
+     */
+    struct iterator : range_detail::iterator_facade<iterator, std::random_access_iterator_tag, typename std::iterator_traits<base_iterator>::value_type, reference> {
+        base_iterator first; ///< The beginning of the base range
+        std::size_t i = 0;   ///< The index of the current element in the view
+        std::size_t s = 1;   ///< The stride
+
+        iterator() = default;
+        iterator(base_iterator first, std::size_t i, std::size_t s) : first(first), i(i), s(s) {}
+
+        reference dereference() const {
+            return first[i * s];
+        }
+
+        void increment() {
+            ++i;
+        }
+
+        void decrement() {
+            --i;
+        }
+
+        void advance(std::ptrdiff_t d) {
+            i += d;
+        }
+
+        std::ptrdiff_t distance_to(const iterator& other) const {
+            return std::ptrdiff_t(other.i) - std::ptrdiff_t(i);
+        }
+
+        bool equal(const iterator& other) const {
+            return i == other.i;
+        }
+    };
+
+    /*!
+     * \brief Construct the view
+     * \param base The base range
+     * \param s The stride
+     */
+    stride_view(R&& base, std::size_t s) : base(std::forward<R>(base)), s(s) {
+        cpp_assert(s > 0, "stride_view needs a stride of at least one");
+    }
+
+    /*!
+     * \brief Returns an iterator to the first element of the view
+     */
+    iterator begin() const {
+        return {std::begin(base), 0, s};
+    }
+
+    /*!
+     * \brief Returns an iterator past the last element of the view
+     */
+    iterator end() const {
+        return {std::begin(base), size(), s};
+    }
+
+    /*!
+     * \brief Returns the number of elements of the view
+     */
+    std::size_t size() const {
+        return (n() + s - 1) / s;
+    }
+
+    /*!
+     * \brief Returns the number of elements of the view
+     */
+    std::size_t base_size() const {
+        return size();
+    }
+
+    /*!
+     * \brief Returns a view of the elements [first, last) of the view
+     */
+    auto slice(std::size_t first, std::size_t last) const {
+        using sub_range = decltype(range_detail::slice(base, 0, 0));
+        const auto b    = std::min(n(), first * s);
+        const auto e    = last > first ? std::min(n(), (last - 1) * s + 1) : b;
+        return stride_view<sub_range>(range_detail::slice(base, b, e), s);
+    }
+
+private:
+    std::size_t n() const {
+        return std::end(base) - std::begin(base);
+    }
+
+    R base;        ///< The base range
+    std::size_t s; ///< The stride
+};
+
+/*!
+ * \brief Returns a lazy view of the transformation of each element of the given range
+ * \param r The range
+ * \param fun The transform functor
+ */
+template <typename R, typename F>
+transform_view<R, F> transformed(R&& r, F fun) {
+    return transform_view<R, F>(std::forward<R>(r), std::move(fun));
+}
+
+/*!
+ * \brief Returns a lazy view of the elements of the given range that satisfy the predicate
+ * \param r The range
+ * \param pred The predicate
+ */
+template <typename R, typename P>
+filter_view<R, P> filtered(R&& r, P pred) {
+    return filter_view<R, P>(std::forward<R>(r), std::move(pred));
+}
+
+/*!
+ * \brief Returns a lazy view of the tuples of elements at the same position in the given ranges
+ * \param r The ranges
+ */
+template <typename... R>
+zip_view<R...> zipped(R&&... r) {
+    return zip_view<R...>(std::forward<R>(r)...);
+}
+
+/*!
+ * \brief Returns a lazy view of the elements of the given range with their position
+ * \param r The range
+ */
+template <typename R>
+enumerate_view<R> enumerated(R&& r) {
+    return enumerate_view<R>(std::forward<R>(r));
+}
+
+/*!
+ * \brief Returns a lazy view of the chunks of k elements of the given range
+ * \param r The range
+ * \param k The size of the chunks
+ */
+template <typename R>
+chunk_view<R> chunked(R&& r, std::size_t k) {
+    return chunk_view<R>(std::forward<R>(r), k);
+}
+
+/*!
+ * \brief Returns a lazy view of every s-th element of the given range
+ * \param r The range
+ * \param s The stride
+ */
+template <typename R>
+stride_view<R> strided(R&& r, std::size_t s) {
+    return stride_view<R>(std::forward<R>(r), s);
+}
+
+} //end of the cpp namespace
+
+#endif //CPP_UTILS_VIEWS_HPP